@@ -0,0 +1,109 @@
+#include "functions.h"
+#include <math.h>
+
+// PONG AI METHODS
+
+PongAI::PongAI() {
+    for (int p = 0; p < 2; p++) { setDifficulty(p, 5); }
+    reset();
+}
+
+// Forgets every prediction and re-centres the targets, for a new match
+void PongAI::reset() {
+    for (int i = 0; i < MAX_NUM_OF_BALLS; i++) {
+        keyXSpeed[i] = 0;
+        keyYSpeed[i] = 0;
+    }
+    tick = 0;
+    target[0] = -1;
+    target[1] = -1;
+    predictions = 0;
+}
+
+void PongAI::setDifficulty(int paddle, int difficulty) {
+    difficulty = max(0, min(difficulty, 10));
+    int latency_ms = AI_MAX_LATENCY_MS - (AI_MAX_LATENCY_MS - AI_MIN_LATENCY_MS) * difficulty / 10;
+    latency[paddle] = latency_ms * AI_HZ / 1000;
+    maxError[paddle] = AI_MAX_ERROR * (10 - difficulty) / 10;
+}
+
+// y the ball's centre has when it touches the paddle face
+float PongAI::paddleLine(Board& board, const BallPool& balls, int paddle) const {
+    if (paddle == 0) { return board.paddles[0].getBottom() + balls.getRadius(); }
+    return board.paddles[1].getTop() - balls.getRadius();
+}
+
+// Straight-line flight to the paddle line, then folded back into the playfield:
+// a wall bounce is a mirror image, so the unfolded x modulo twice the width
+// gives the landing x without stepping through each bounce
+float PongAI::predictIntercept(Board& board, const BallPool& balls, int i, float line) const {
+    float t = max(0.0f, (line - balls.gety(i)) / balls.gety_speed(i));
+    float x = balls.getx(i) + balls.getx_speed(i) * t;
+    float lo = board.getMinWidth() + balls.getRadius();
+    float span = board.getMaxWidth() - balls.getRadius() - lo;
+    float u = fmodf(x - lo, 2 * span);
+    if (u < 0) { u += 2 * span; }
+    if (u > span) { u = 2 * span - u; }
+    return lo + u;
+}
+
+// Called at AI_HZ: refreshes stale predictions, picks each AI paddle's most
+// urgent ball and nudges the paddle one button press toward it
+void PongAI::update(Board& board, const BallPool& balls, bool enabled1, bool enabled2) {
+    bool enabled[2] = {enabled1, enabled2};
+    float line[2] = {paddleLine(board, balls, 0), paddleLine(board, balls, 1)};
+    float soonest[2] = {INFINITY, INFINITY};
+    int best[2] = {-1, -1};
+    bool incoming[2] = {false, false};
+    tick++;
+
+    for (int i = balls.first(); i >= 0; i = balls.next(i)) {
+        float y_speed = balls.gety_speed(i);
+        int p = y_speed < 0 ? 0 : 1;
+        if (y_speed == 0 || !enabled[p]) { continue; }
+        // already past the paddle line: lost, so not worth chasing
+        float time_to_impact = (line[p] - balls.gety(i)) / y_speed;
+        if (time_to_impact < 0) { continue; }
+        incoming[p] = true;
+
+        float x_speed = fabsf(balls.getx_speed(i));
+        if (x_speed != keyXSpeed[i] || y_speed != keyYSpeed[i]) {
+            interceptX[i] = predictIntercept(board, balls, i, line[p]);
+            aimError[i] = randBetween(-1, 1);
+            keyXSpeed[i] = x_speed;
+            keyYSpeed[i] = y_speed;
+            predictedAt[i] = tick;
+            predictions++;
+        }
+        // the paddle has not "seen" this bounce yet
+        if (tick - predictedAt[i] < latency[p]) { continue; }
+
+        if (time_to_impact < soonest[p]) {
+            soonest[p] = time_to_impact;
+            best[p] = i;
+        }
+    }
+
+    for (int p = 0; p < 2; p++) {
+        if (!enabled[p]) { continue; }
+        Paddle& paddle = board.paddles[p];
+        float width = paddle.getRight() - paddle.getLeft();
+        if (best[p] >= 0) {
+            target[p] = interceptX[best[p]] + aimError[best[p]] * maxError[p] * width;
+        } else if (!incoming[p] || target[p] < 0) {
+            // nothing to play (or nothing seen yet), so drift back to the middle
+            target[p] = (board.getMinWidth() + board.getMaxWidth()) / 2.0f;
+        }
+
+        // a button press moves a quarter width, so stop within half of that
+        float off = target[p] - (paddle.getLeft() + paddle.getRight()) / 2.0f;
+        if (off > width / 8) {
+            paddle.moveRight();
+        } else if (off < -width / 8) {
+            paddle.moveLeft();
+        }
+    }
+}
+
+float PongAI::getTarget(int paddle) const { return target[paddle]; }
+uint32_t PongAI::getPredictions() const { return predictions; }
@@ -0,0 +1,121 @@
+#include "display.h"
+#include <string.h>
+
+#define VSYNC_FLAG 0x1
+
+static EventFlags vsync_flags;
+
+extern LTDC_HandleTypeDef LtdcHandler; // the BSP's
+
+// Fires on the first line of vertical blanking, after a queued layer reload
+// has been applied
+static void LtdcLineISR() {
+    if (LTDC->ISR & LTDC_ISR_LIF) {
+        LTDC->ICR = LTDC_ICR_CLIF;
+        vsync_flags.set(VSYNC_FLAG);
+    }
+}
+
+// DISPLAY METHODS
+
+Display::Display() : back(1), doubleBuffered(false), flipPending(false), drawingOverlay(-1) {
+    buffers[0] = DISPLAY_FRAME_BUFFER_A;
+    buffers[1] = DISPLAY_FRAME_BUFFER_B;
+}
+
+// Switches both layers to GFX_PIXEL_FORMAT (the BSP sets them up as
+// ARGB8888), blanks every buffer and page, keys layer 1 on DISPLAY_COLOR_KEY
+// and arms the LTDC line interrupt. Call once, after the LCD has been
+// initialised.
+void Display::init() {
+    for (int layer = 0; layer < 2; layer++) {
+#if GFX_PIXEL_FORMAT == GFX_FORMAT_L8
+        uint32_t clut[GFX_PALETTE_SIZE];
+        for (int i = 0; i < GFX_PALETTE_SIZE; i++) { clut[i] = GFX_PALETTE[i] & 0x00FFFFFF; }
+        HAL_LTDC_ConfigCLUT(&LtdcHandler, clut, GFX_PALETTE_SIZE, layer);
+        HAL_LTDC_EnableCLUT(&LtdcHandler, layer);
+#endif
+        if (GFX_COLOR_MODE != LTDC_PIXEL_FORMAT_ARGB8888) {
+            HAL_LTDC_SetPixelFormat(&LtdcHandler, GFX_COLOR_MODE, layer);
+        }
+    }
+    // zero is black in every format, and the game never draws over the HUD
+    // strip, so layer 0 stays black under it
+    int frame_bytes = BSP_LCD_GetXSize() * BSP_LCD_GetYSize() * GFX_BYTES_PER_PIXEL;
+    memset((void*)buffers[0], 0, frame_bytes);
+    memset((void*)buffers[1], 0, frame_bytes);
+    for (int i = 0; i < GFX_NUM_OVERLAYS; i++) { memset((void*)(DISPLAY_OVERLAY_PAGES + i * DISPLAY_PAGE_BYTES), 0, frame_bytes); }
+    BSP_LCD_SetColorKeying(1, DISPLAY_COLOR_KEY);
+
+
+    LTDC->LIPCR = (LTDC->AWCR & LTDC_AWCR_AAH) + 1; // first line after the active area
+    LTDC->ICR = LTDC_ICR_CLIF;
+    LTDC->IER |= LTDC_IER_LIE;
+    NVIC_SetVector(LTDC_IRQn, (uint32_t)&LtdcLineISR);
+    NVIC_EnableIRQ(LTDC_IRQn);
+}
+
+// Points the BSP draw calls at a buffer. The BSP draws wherever layer 0's
+// FBStartAdress in the HAL handle points. Only that field changes here, not
+// CFBAR: any reload (showOverlay) applies every shadow register, and the
+// scanned-out buffer must only move in present().
+void Display::retarget(uint32_t address) {
+    BSP_LCD_SelectLayer(0);
+    LtdcHandler.LayerCfg[0].FBStartAdress = address;
+}
+
+// The back buffer starts out as a copy of nothing; callers repaint everything
+// on the first frame (Board::invalidate)
+void Display::beginDoubleBuffering() {
+    if (doubleBuffered) { return; }
+    doubleBuffered = true;
+    retarget(buffers[back]);
+}
+
+bool Display::isDoubleBuffered() const { return doubleBuffered; }
+
+// Sends the gfx calls to an overlay page, or back to the game with -1
+void Display::drawOverlay(int overlay) { drawingOverlay = overlay; }
+
+// Composites an overlay page, or none with -1, over the game from the next
+// vertical blank. Layer 1 only scans out the top height rows of the page, and
+// hiding the game leaves the LTDC background (black) under the overlay.
+void Display::showOverlay(int overlay, int height, bool game_visible) {
+    if (overlay >= 0) {
+        BSP_LCD_SetLayerAddress_NoReload(1, DISPLAY_OVERLAY_PAGES + overlay * DISPLAY_PAGE_BYTES);
+        BSP_LCD_SetLayerWindow_NoReload(1, 0, 0, BSP_LCD_GetXSize(), height);
+    }
+    BSP_LCD_SetLayerVisible_NoReload(1, overlay >= 0 ? ENABLE : DISABLE);
+    BSP_LCD_SetLayerVisible_NoReload(0, game_visible ? ENABLE : DISABLE);
+    BSP_LCD_Relaod(LCD_RELOAD_VERTICAL_BLANKING);
+}
+
+// Frame buffer or overlay page the gfx calls currently draw into
+uint32_t Display::drawAddress() const {
+    if (drawingOverlay >= 0) { return DISPLAY_OVERLAY_PAGES + drawingOverlay * DISPLAY_PAGE_BYTES; }
+    return doubleBuffered ? buffers[back] : buffers[back ^ 1];
+}
+
+// Queues the finished back buffer to be scanned out from the next vertical
+// blank. Drawing must wait for waitForVsync(), which retargets it to the
+// other buffer once the flip has happened.
+void Display::present() {
+    if (!doubleBuffered) { return; }
+    BSP_LCD_SetLayerAddress_NoReload(0, buffers[back]);
+    BSP_LCD_Relaod(LCD_RELOAD_VERTICAL_BLANKING);
+    back ^= 1;
+    flipPending = true;
+}
+
+// Blocks until the next DISPLAY_VSYNC_DIVIDER-th vertical blank. If a flip was
+// queued it also waits for the reload to land, then draws into the new back
+// buffer.
+void Display::waitForVsync() {
+    for (int i = 0; i < DISPLAY_VSYNC_DIVIDER || (flipPending && (LTDC->SRCR & LTDC_SRCR_VBR)); i++) {
+        vsync_flags.wait_any(VSYNC_FLAG);
+    }
+    if (flipPending) {
+        flipPending = false;
+        retarget(buffers[back]);
+    }
+}
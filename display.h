@@ -0,0 +1,48 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include "mbed.h"
+#include "LCD_DISCO_F429ZI.h"
+#include "gfx.h"
+
+#ifndef DISPLAY_DOUBLE_BUFFER
+#define DISPLAY_DOUBLE_BUFFER 1 // 1 to draw the game into a back buffer and flip on vsync
+#endif
+#define DISPLAY_VSYNC_DIVIDER 1 // frames are paced every Nth vsync (~65 Hz on the DISCO panel)
+#define DISPLAY_FRAME_BUFFER_A (LCD_FRAME_BUFFER + 0x130000) // layer 0 as set up by LCD_DISCO_F429ZI
+#define DISPLAY_FRAME_BUFFER_B (LCD_FRAME_BUFFER + 0x200000) // second 240x320 buffer in SDRAM, room for ARGB8888
+#define DISPLAY_OVERLAY_PAGES LCD_FRAME_BUFFER // layer 1 as set up by LCD_DISCO_F429ZI, one page per GfxOverlay
+#define DISPLAY_PAGE_BYTES 0x4B000 // a 240x320 ARGB8888 page, so all of them fit below layer 0
+#define DISPLAY_COLOR_KEY 0x000000 // overlay pixels of this colour show the game through
+
+// Display Class
+// Page flipping for LTDC layer 0, the game. While double buffering, every
+// BSP/LCD draw call lands in the back buffer; present() hands it to the LTDC
+// from the next vertical blank and waitForVsync() paces the render loop on the
+// LTDC line interrupt, so the panel never scans out a half-drawn frame.
+// Layer 1 composites one overlay page (HUD, menu or pause screen) on top,
+// colour keyed on DISPLAY_COLOR_KEY. The pages are drawn once and switching
+// screens only changes which one the LTDC reads.
+class Display {
+private:
+    uint32_t buffers[2];
+    int back;
+    bool doubleBuffered;
+    bool flipPending;
+    int drawingOverlay; // page the gfx calls draw into, -1 for the game
+    void retarget(uint32_t address);
+public:
+    Display();
+    void init();
+    void beginDoubleBuffering();
+    bool isDoubleBuffered() const;
+    void drawOverlay(int overlay);
+    void showOverlay(int overlay, int height, bool game_visible);
+    uint32_t drawAddress() const;
+    void present();
+    void waitForVsync();
+};
+
+extern Display display;
+
+#endif // DISPLAY_H
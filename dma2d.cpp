@@ -0,0 +1,121 @@
+#include "dma2d.h"
+
+#define DMA2D_MODE_M2M 0x00000000
+#define DMA2D_MODE_M2M_BLEND DMA2D_CR_MODE_1
+#define DMA2D_MODE_R2M DMA2D_CR_MODE
+#define DMA2D_DONE_FLAG 0x1
+
+Dma2dQueue dma2d;
+static EventFlags dma2d_flags;
+
+static void Dma2dISR() {
+    dma2d.onTransferComplete();
+}
+
+// DMA2D QUEUE METHODS
+
+Dma2dQueue::Dma2dQueue() : head(0), tail(0), running(false), colorMode(DMA2D_COLOR_ARGB8888), shadowValid(false) {}
+
+void Dma2dQueue::init(uint32_t frameColorMode) {
+    colorMode = frameColorMode;
+    __HAL_RCC_DMA2D_CLK_ENABLE();
+    NVIC_SetVector(DMA2D_IRQn, (uint32_t)&Dma2dISR);
+    NVIC_EnableIRQ(DMA2D_IRQn);
+}
+
+// Fills a width x height block at dst with one color
+void Dma2dQueue::fill(uint32_t dst, int dstOffset, int width, int height, uint32_t color) {
+    if (width <= 0 || height <= 0) { return; }
+    Dma2dCommand cmd = {DMA2D_MODE_R2M, 0, dst, 0, (uint16_t)dstOffset, (uint16_t)width, (uint16_t)height, color};
+    push(cmd);
+}
+
+// Copies a width x height block from src to dst, same pixel format
+void Dma2dQueue::copy(uint32_t src, int srcOffset, uint32_t dst, int dstOffset, int width, int height) {
+    if (width <= 0 || height <= 0) { return; }
+    Dma2dCommand cmd = {DMA2D_MODE_M2M, src, dst, (uint16_t)srcOffset, (uint16_t)dstOffset, (uint16_t)width, (uint16_t)height, 0};
+    push(cmd);
+}
+
+// Alpha-blends a width x height ARGB block from src over dst, in place
+void Dma2dQueue::blend(uint32_t src, int srcOffset, uint32_t dst, int dstOffset, int width, int height) {
+    if (width <= 0 || height <= 0) { return; }
+    Dma2dCommand cmd = {DMA2D_MODE_M2M_BLEND, src, dst, (uint16_t)srcOffset, (uint16_t)dstOffset, (uint16_t)width, (uint16_t)height, 0};
+    push(cmd);
+}
+
+// Queues a transfer, starting it at once if DMA2D is idle. Blocks only when
+// the ring is full.
+void Dma2dQueue::push(const Dma2dCommand& cmd) {
+    while ((uint16_t)(head - tail) >= DMA2D_QUEUE_SIZE) { dma2d_flags.wait_any(DMA2D_DONE_FLAG); }
+    ring[head & (DMA2D_QUEUE_SIZE - 1)] = cmd;
+    core_util_critical_section_enter();
+    head = head + 1;
+    if (!running) {
+        running = true;
+        startNext();
+    }
+    core_util_critical_section_exit();
+}
+
+// Programs and starts the transfer at tail. Runs with DMA2D idle, from the
+// ISR or inside a critical section.
+void Dma2dQueue::startNext() {
+    const Dma2dCommand& cmd = ring[tail & (DMA2D_QUEUE_SIZE - 1)];
+    tail = tail + 1;
+    if (!shadowValid) {
+        DMA2D->OPFCCR = colorMode == DMA2D_COLOR_L8 ? DMA2D_COLOR_ARGB8888 : colorMode; // alpha untouched
+        DMA2D->BGPFCCR = colorMode;
+    }
+    // copies move frame-format pixels, blends read the ARGB8888 sprite
+    uint32_t fgpfccr = cmd.mode == DMA2D_MODE_M2M_BLEND ? DMA2D_COLOR_ARGB8888 : colorMode;
+    if (cmd.mode != DMA2D_MODE_R2M && (!shadowValid || fgpfccr != lastFgpfccr)) {
+        DMA2D->FGPFCCR = lastFgpfccr = fgpfccr;
+    }
+    if (!shadowValid || cmd.dstOffset != lastOor) {
+        DMA2D->OOR = lastOor = cmd.dstOffset;
+    }
+    if (cmd.mode == DMA2D_MODE_R2M) {
+        if (!shadowValid || cmd.color != lastOcolr) {
+            DMA2D->OCOLR = lastOcolr = cmd.color;
+        }
+    } else {
+        DMA2D->FGMAR = cmd.src;
+        if (!shadowValid || cmd.srcOffset != lastFgor) {
+            DMA2D->FGOR = lastFgor = cmd.srcOffset;
+        }
+        if (cmd.mode == DMA2D_MODE_M2M_BLEND) {
+            DMA2D->BGMAR = cmd.dst;
+            if (!shadowValid || cmd.dstOffset != lastBgor) {
+                DMA2D->BGOR = lastBgor = cmd.dstOffset;
+            }
+        }
+    }
+    shadowValid = true;
+    lastMode = cmd.mode;
+    DMA2D->OMAR = cmd.dst;
+    DMA2D->NLR = ((uint32_t)cmd.width << DMA2D_NLR_PL_Pos) | cmd.height;
+    DMA2D->CR = cmd.mode | DMA2D_CR_TCIE | DMA2D_CR_START;
+}
+
+// Transfer-complete interrupt: chains the next transfer, or goes idle with the
+// interrupt masked so the BSP's own polled transfers are left alone
+void Dma2dQueue::onTransferComplete() {
+    DMA2D->IFCR = DMA2D_IFCR_CTCIF | DMA2D_IFCR_CTEIF | DMA2D_IFCR_CCEIF;
+    if (tail != head) {
+        startNext();
+    } else {
+        running = false;
+        DMA2D->CR = lastMode;
+    }
+    dma2d_flags.set(DMA2D_DONE_FLAG);
+}
+
+bool Dma2dQueue::busy() const { return running; }
+
+// Blocks (letting other threads run) until every queued transfer is done.
+// Whoever draws next may reprogram DMA2D, so the register shadow is dropped.
+void Dma2dQueue::sync() {
+    while (running) { dma2d_flags.wait_any(DMA2D_DONE_FLAG); }
+    shadowValid = false;
+}
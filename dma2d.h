@@ -0,0 +1,61 @@
+#ifndef DMA2D_H
+#define DMA2D_H
+
+#include "mbed.h"
+
+#define DMA2D_QUEUE_SIZE 32 // queued transfers, must be a power of two
+#define DMA2D_COLOR_ARGB8888 0 // PFCCR CM values for the frame buffer format
+#define DMA2D_COLOR_RGB565 2
+#define DMA2D_COLOR_L8 5       // input only: copies, no fills or blends
+
+// One queued DMA2D transfer. Addresses are bytes, offsets are the pixels
+// skipped between the end of one line and the start of the next.
+struct Dma2dCommand {
+    uint32_t mode;
+    uint32_t src; // foreground; for blends the background is dst
+    uint32_t dst;
+    uint16_t srcOffset;
+    uint16_t dstOffset;
+    uint16_t width;
+    uint16_t height;
+    uint32_t color;
+};
+
+// DMA2D Queue Class
+// Runs register-to-memory fills and memory-to-memory copies and blends in the
+// background. Transfers are started back to back from the transfer-complete
+// interrupt, and only the registers that differ from the previous transfer are
+// rewritten. The BSP drives DMA2D itself, so sync() before any BSP draw call.
+// Fills and copies are in the frame buffer's colour mode, given to init();
+// blends take an ARGB8888 foreground.
+class Dma2dQueue {
+private:
+    Dma2dCommand ring[DMA2D_QUEUE_SIZE];
+    volatile uint16_t head; // next slot to fill
+    volatile uint16_t tail; // next slot to start
+    volatile bool running;
+    uint32_t colorMode;
+    // last values written, so unchanged registers are skipped
+    bool shadowValid;
+    uint32_t lastMode;
+    uint32_t lastOor;
+    uint32_t lastFgor;
+    uint32_t lastBgor;
+    uint32_t lastOcolr;
+    uint32_t lastFgpfccr;
+    void push(const Dma2dCommand& cmd);
+    void startNext();
+public:
+    Dma2dQueue();
+    void init(uint32_t frameColorMode);
+    void fill(uint32_t dst, int dstOffset, int width, int height, uint32_t color);
+    void copy(uint32_t src, int srcOffset, uint32_t dst, int dstOffset, int width, int height);
+    void blend(uint32_t src, int srcOffset, uint32_t dst, int dstOffset, int width, int height);
+    bool busy() const;
+    void sync();
+    void onTransferComplete();
+};
+
+extern Dma2dQueue dma2d;
+
+#endif // DMA2D_H
@@ -0,0 +1,69 @@
+#ifndef FIXED_H
+#define FIXED_H
+
+#include <stdint.h>
+
+#define FIX16_FRAC_BITS 16
+#define FIX16_ONE (1 << FIX16_FRAC_BITS)
+
+// Q16.16 signed fixed-point number. Arithmetic and comparisons are pure integer
+// operations, so results are bit-identical on every target and bounded in time.
+class Fix16 {
+public:
+    int32_t raw;
+
+    constexpr Fix16() : raw(0) {}
+    constexpr Fix16(int v) : raw(v * FIX16_ONE) {}
+    constexpr Fix16(double v) : raw((int32_t)(v * FIX16_ONE + (v >= 0 ? 0.5 : -0.5))) {}
+
+    static constexpr Fix16 fromRaw(int32_t r) { Fix16 f; f.raw = r; return f; }
+
+    explicit constexpr operator float() const { return (float)raw / FIX16_ONE; }
+
+    Fix16& operator+=(Fix16 o) { raw += o.raw; return *this; }
+    Fix16& operator-=(Fix16 o) { raw -= o.raw; return *this; }
+    Fix16& operator*=(Fix16 o) { raw = (int32_t)(((int64_t)raw * o.raw) >> FIX16_FRAC_BITS); return *this; }
+
+    friend constexpr Fix16 operator-(Fix16 a) { return fromRaw(-a.raw); }
+    friend constexpr Fix16 operator+(Fix16 a, Fix16 b) { return fromRaw(a.raw + b.raw); }
+    friend constexpr Fix16 operator-(Fix16 a, Fix16 b) { return fromRaw(a.raw - b.raw); }
+    friend constexpr Fix16 operator*(Fix16 a, Fix16 b) { return fromRaw((int32_t)(((int64_t)a.raw * b.raw) >> FIX16_FRAC_BITS)); }
+    friend constexpr Fix16 operator/(Fix16 a, Fix16 b) { return fromRaw((int32_t)(((int64_t)a.raw * FIX16_ONE) / b.raw)); }
+
+    friend constexpr bool operator<(Fix16 a, Fix16 b) { return a.raw < b.raw; }
+    friend constexpr bool operator>(Fix16 a, Fix16 b) { return a.raw > b.raw; }
+    friend constexpr bool operator<=(Fix16 a, Fix16 b) { return a.raw <= b.raw; }
+    friend constexpr bool operator>=(Fix16 a, Fix16 b) { return a.raw >= b.raw; }
+    friend constexpr bool operator==(Fix16 a, Fix16 b) { return a.raw == b.raw; }
+    friend constexpr bool operator!=(Fix16 a, Fix16 b) { return a.raw != b.raw; }
+};
+
+inline Fix16 abs(Fix16 a) { return a.raw < 0 ? -a : a; }
+inline Fix16 min(Fix16 a, Fix16 b) { return a > b ? b : a; }
+inline Fix16 max(Fix16 a, Fix16 b) { return a < b ? b : a; }
+
+// Rounds to the nearest integer, halves away from zero (matches roundf)
+inline int round(Fix16 a) {
+    return a.raw >= 0 ? (a.raw + FIX16_ONE / 2) >> FIX16_FRAC_BITS : -((-a.raw + FIX16_ONE / 2) >> FIX16_FRAC_BITS);
+}
+
+// Integer square root of a non-negative Q16.16 value
+inline Fix16 sqrt(Fix16 a) {
+    if (a.raw <= 0) { return Fix16(); }
+    uint64_t v = (uint64_t)a.raw << FIX16_FRAC_BITS;
+    uint64_t res = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+    while (bit > v) { bit >>= 2; }
+    while (bit != 0) {
+        if (v >= res + bit) {
+            v -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+    return Fix16::fromRaw((int32_t)res);
+}
+
+#endif // FIXED_H
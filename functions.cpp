@@ -0,0 +1,968 @@
+#include "functions.h"
+#include "mbed.h"
+#include <vector>
+#include <cstdlib>
+
+// OBJECTS --------------------------------
+// BOARD OBJECT METHODS
+        
+// Constructor
+Board::Board(int min_width, int min_height, int max_width, int max_height) : min_width(min_width), min_height(min_height), max_width(max_width), max_height(max_height) {
+    rngInit();
+    gameSeed(rngGetRandomNumber());
+    balls.spawn(min_width+(max_width-min_width)/2, min_height+(max_height-min_height)/2);
+    paddles.emplace_back((int)((float)(max_width-min_width) / 2 - (0.15 * (max_width-min_width)) / 2), min_height + 5, *this);
+    paddles.emplace_back((int)((float)(max_width-min_width) / 2 - (0.15 * (max_width-min_width)) / 2), max_height - 10, *this);
+    score1 = 0;
+    score2 = 0;
+    ball_collisions = false;
+    ai_step_counter = 0;
+    ai.setDifficulty(0, AI1_DIFFICULTY);
+    ai.setDifficulty(1, AI2_DIFFICULTY);
+    force_redraw = true;
+    double_buffered = false;
+    drawnScore1 = -1;
+    drawnScore2 = -1;
+    for (int w = 0; w < BALL_POOL_WORDS; w++) { drawnMask[w] = 0; }
+    snapshot_front = 0;
+    snapshot_middle = 1;
+    snapshot_back = 2;
+    for (int i = 0; i < NUM_INPUTS; i++) { pending_inputs[i] = 0; }
+    pending_p2_pos = -1;
+    pending_match = false;
+    pending_seed = 0;
+    step_count = 0;
+    recorder = nullptr;
+    rf_keyframe_request = false;
+    rf_tracker.setBounds(min_width + balls.getRadius(), max_width - balls.getRadius(), min_height + balls.getRadius(),
+                         max_height - balls.getRadius());
+    rf_tick = 0;
+    rf_tick_ms = 0;
+    rf_clock = false;
+    publishSnapshot(0);
+    acquireSnapshot();
+}
+
+// Destructor
+Board::~Board() {}
+
+int Board::getMinHeight() const { return min_height; }
+int Board::getMinWidth() const { return min_width; }
+int Board::getMaxHeight() const { return max_height; }
+int Board::getMaxWidth() const { return max_width; }
+// Draws the acquired snapshot. Balls are interpolated between their last two
+// physics states, alpha being the fraction of a physics step elapsed since the
+// snapshot. Only what changed since the last frame is repainted: the old and
+// new footprint of every ball and paddle that moved, and the scoreboard when a
+// score changed, are collected as dirty rects and each merged rect is cleared
+// and recomposed in one pass.
+void Board::render(float alpha) {
+    const BoardSnapshot& snap = snapshots[snapshot_front];
+    int radius = balls.getRadius();
+    int size = 2 * radius + 1;
+    uint32_t seen[BALL_POOL_WORDS] = {0};
+    for (int n = 0; n < snap.num_balls; n++) {
+        int slot = snap.balls[n].slot;
+        seen[slot >> 5] |= (1u << (slot & 31));
+    }
+    if (force_redraw) {
+        dirty.add(0, 0, max_width, max_height);
+    }
+
+    // balls that left the board
+    for (int w = 0; w < BALL_POOL_WORDS; w++) {
+        uint32_t gone = drawnMask[w] & ~seen[w];
+        while (gone) {
+            int slot = (w << 5) + __builtin_ctz(gone);
+            dirty.add(drawnX[slot] - radius, drawnY[slot] - radius, size, size);
+            gone &= gone - 1;
+        }
+    }
+    // balls that moved or appeared
+    for (int n = 0; n < snap.num_balls; n++) {
+        const BallState& ball = snap.balls[n];
+        int slot = ball.slot;
+        bool drawn = drawnMask[slot >> 5] & (1u << (slot & 31));
+        int drawX = round(ball.prevX + (ball.x - ball.prevX) * alpha);
+        int drawY = round(ball.prevY + (ball.y - ball.prevY) * alpha);
+        if (drawn && drawX == drawnX[slot] && drawY == drawnY[slot]) {
+            continue;
+        }
+        if (drawn) {
+            dirty.add(drawnX[slot] - radius, drawnY[slot] - radius, size, size);
+        }
+        dirty.add(drawX - radius, drawY - radius, size, size);
+        drawnX[slot] = drawX;
+        drawnY[slot] = drawY;
+    }
+    for (int w = 0; w < BALL_POOL_WORDS; w++) { drawnMask[w] = seen[w]; }
+    paddles[0].markDirty(snap.paddle_x[0], dirty);
+    paddles[1].markDirty(snap.paddle_x[1], dirty);
+    // the scoreboard lives on the HUD overlay, so it is only redrawn when the
+    // score changes, never because something moved under it
+    if (force_redraw || snap.score1 != drawnScore1 || snap.score2 != drawnScore2) {
+        drawnScore1 = snap.score1;
+        drawnScore2 = snap.score2;
+        drawScoreboard();
+    }
+
+    // a double-buffered frame lands in the buffer shown two frames ago, so it
+    // also has to catch up on whatever changed in the frame in between
+    DirtyRects fresh = dirty;
+    if (double_buffered) { dirty.addAll(previous_dirty); }
+    previous_dirty = fresh;
+
+    // flush: clear every rect, then put back whatever overlaps them. All the
+    // clears go first, so rasterised balls (CPU stores) wait for DMA2D only
+    // once, and sprite blits simply queue up behind them.
+    DirtyRect cleared[DIRTY_MAX_RECTS];
+    int num_cleared = 0;
+    for (int d = 0; d < dirty.size(); d++) {
+        DirtyRect r = dirty.get(d);
+        r.x0 = max(r.x0, (int16_t)0);
+        r.x1 = min(r.x1, (int16_t)max_width);
+        r.y0 = max(r.y0, (int16_t)min_height);
+        r.y1 = min(r.y1, (int16_t)max_height);
+        if (r.x0 >= r.x1 || r.y0 >= r.y1) { continue; }
+        gfxFillRect(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0, LCD_COLOR_BLACK);
+        cleared[num_cleared++] = r;
+    }
+    // each ball at most once, even if several rects cut it
+    for (int w = 0; w < BALL_POOL_WORDS; w++) {
+        for (uint32_t bits = drawnMask[w]; bits; bits &= bits - 1) {
+            int slot = (w << 5) + __builtin_ctz(bits);
+            for (int d = 0; d < num_cleared; d++) {
+                const DirtyRect& r = cleared[d];
+                if (drawnX[slot] + radius >= r.x0 && drawnX[slot] - radius < r.x1 &&
+                    drawnY[slot] + radius >= r.y0 && drawnY[slot] - radius < r.y1) {
+                    if (GFX_USE_SPRITES) {
+                        gfxDrawSprite(GFX_SPRITE_BALL, drawnX[slot] - radius, drawnY[slot] - radius, 0, 0, max_width, max_height);
+                    } else {
+                        gfxFillCircle(drawnX[slot], drawnY[slot], radius, LCD_COLOR_WHITE);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    for (int d = 0; d < num_cleared; d++) {
+        paddles[0].drawClipped(cleared[d]);
+        paddles[1].drawClipped(cleared[d]);
+    }
+    dirty.clear();
+    force_redraw = false;
+}
+void Board::drawScoreboard() {
+    gfxBeginOverlay(GFX_OVERLAY_HUD);
+    gfxFillRect(min_width, 0, max_width - min_width, min_height, LCD_COLOR_WHITE);
+    char score_str[30];
+    sprintf(score_str, "(P1) %d - %d (P2)", drawnScore1, drawnScore2);
+    gfxDrawString(0, min_height/2-4, score_str, &Font12, LCD_COLOR_BLACK, LCD_COLOR_WHITE, CENTER_MODE);
+    gfxEndOverlay();
+}
+// Forces the next frame to repaint everything, e.g. after a clear
+void Board::invalidate() {
+    force_redraw = true;
+    paddles[0].invalidate();
+    paddles[1].invalidate();
+}
+// Tells render() whether it draws into alternating buffers (see Display)
+void Board::setDoubleBuffered(bool enabled) {
+    double_buffered = enabled;
+    previous_dirty.clear();
+}
+// Producer side: copies the current state into the back buffer and swaps it
+// into the hand-off slot. Never blocks, so it is safe from a thread or ISR.
+void Board::publishSnapshot(uint32_t time_ms) {
+    BoardSnapshot& snap = snapshots[snapshot_back];
+    snap.num_balls = 0;
+    for (int i = balls.first(); i >= 0; i = balls.next(i)) {
+        BallState& ball = snap.balls[snap.num_balls++];
+        ball.slot = i;
+        ball.x = balls.getx(i);
+        ball.y = balls.gety(i);
+        ball.prevX = balls.getprevx(i);
+        ball.prevY = balls.getprevy(i);
+        ball.x_speed = balls.getx_speed(i);
+        ball.y_speed = balls.gety_speed(i);
+    }
+    snap.paddle_x[0] = paddles[0].getLeft();
+    snap.paddle_x[1] = paddles[1].getLeft();
+    snap.score1 = score1;
+    snap.score2 = score2;
+    snap.time_ms = time_ms;
+    snap.step = step_count;
+    snapshot_back = snapshot_middle.exchange(snapshot_back | SNAPSHOT_FRESH) & ~SNAPSHOT_FRESH;
+}
+// Consumer side: takes the newest published snapshot if there is one. The
+// returned snapshot stays untouched by the producer until the next acquire.
+const BoardSnapshot& Board::acquireSnapshot() {
+    if (snapshot_middle.load() & SNAPSHOT_FRESH) {
+        snapshot_front = snapshot_middle.exchange(snapshot_front) & ~SNAPSHOT_FRESH;
+    }
+    return snapshots[snapshot_front];
+}
+const BoardSnapshot& Board::getSnapshot() const {
+    return snapshots[snapshot_front];
+}
+void Board::moveBalls() {
+    for (int i = balls.first(); i >= 0; i = balls.next(i)) {
+        bool delete_ball = false;
+        balls.move(i, *this, delete_ball);
+
+        // the renderer erases despawned balls when it sees them missing from the snapshot
+        if (delete_ball) {
+            balls.despawn(i);
+        }
+    }
+    if (balls.count() <= 0) {
+        balls.spawn(min_width+(max_width-min_width)/2, min_height+(max_height-min_height)/2);
+    }
+    if (ball_collisions) {
+        balls.collide(*this);
+    }
+
+    // AI opponents, reacting at AI_HZ regardless of the physics rate
+    if (++ai_step_counter < PHYSICS_HZ / AI_HZ) {
+        return;
+    }
+    ai_step_counter = 0;
+    ai.update(*this, balls, ai1_enabled, ai2_enabled);
+}
+// One physics step: a requested match start first, then pending inputs, then the balls
+void Board::step() {
+    if (pending_match.exchange(false)) { startMatch(pending_seed); }
+    applyInputs();
+    moveBalls();
+    step_count++;
+}
+uint32_t Board::getStepCount() const { return step_count; }
+// Safe from any ISR or thread; the input takes effect at the next step
+void Board::queueInput(InputType type, uint8_t arg) {
+    if (type == INPUT_P2_MOVE_TO) {
+        pending_p2_pos = arg;
+    } else if (type < NUM_INPUTS) {
+        pending_inputs[type]++;
+    }
+}
+void Board::applyInputs() {
+    for (int type = 0; type < NUM_INPUTS; type++) {
+        if (type == INPUT_P2_MOVE_TO) {
+            int16_t pos = pending_p2_pos.exchange(-1);
+            if (pos >= 0 && pos != paddles[1].getLeft()) {
+                paddles[1].moveTo(pos);
+                if (recorder) { recorder->recordInput(step_count, INPUT_P2_MOVE_TO, pos); }
+            }
+            continue;
+        }
+        for (uint8_t count = pending_inputs[type].exchange(0); count > 0; count--) {
+            switch (type) {
+                case INPUT_P1_LEFT: paddles[0].moveLeft(); break;
+                case INPUT_P1_RIGHT: paddles[0].moveRight(); break;
+                case INPUT_P2_LEFT: paddles[1].moveLeft(); break;
+                case INPUT_P2_RIGHT: paddles[1].moveRight(); break;
+                case INPUT_SPAWN:
+                    // a press at a full pool is dropped unlogged, so the log
+                    // replays the same on a build with a bigger pool
+                    if (!spawnBall()) { continue; }
+                    break;
+            }
+            if (recorder) { recorder->recordInput(step_count, (InputType)type, 0); }
+        }
+    }
+}
+// Safe from any ISR; the match starts at the next step, so it never resets
+// the board under the physics thread or the AI
+void Board::requestMatch(uint32_t seed) {
+    pending_seed = seed;
+    pending_match = true;
+}
+// Starts a fresh, reproducible match: the seed drives every random draw of
+// the physics and the AI, so it plus the logged inputs replay the match
+void Board::startMatch(uint32_t seed) {
+    gameSeed(seed);
+    resetGame();
+    for (int i = 0; i < NUM_INPUTS; i++) { pending_inputs[i] = 0; }
+    pending_p2_pos = -1;
+    step_count = 0;
+    ai_step_counter = 0;
+    if (recorder) {
+        uint8_t flags = (ai1_enabled ? REPLAY_FLAG_AI1 : 0) | (ai2_enabled ? REPLAY_FLAG_AI2 : 0) |
+                        (wireless ? REPLAY_FLAG_WIRELESS : 0) | (ball_collisions ? REPLAY_FLAG_COLLISIONS : 0) |
+                        (FIXED_POINT_PHYSICS ? REPLAY_FLAG_FIXED_POINT : 0);
+        recorder->begin(seed, flags, PHYSICS_HZ);
+    }
+}
+void Board::endMatch() {
+    if (recorder) { recorder->end(step_count, score1, score2); }
+}
+void Board::setRecorder(ReplayRecorder* recorder) {
+    this->recorder = recorder;
+}
+int Board::getBallRadius() const { return balls.getRadius(); }
+int Board::getNumBalls() const { return balls.count(); }
+bool Board::spawnBall() {
+    if (balls.count() >= maxNumOfBalls) { return false; }
+    return balls.spawn(min_width+(max_width-min_width)/2, min_height+(max_height-min_height)/2) >= 0;
+}
+// Ball speed in px per BALL_SPEED_HZ tick to v3's 1/RF_VELOCITY_SCALE px per physics step
+static int16_t rfVelocity(float speed) {
+    float scaled = roundf(speed * PHYSICS_STEP_SCALE * RF_VELOCITY_SCALE);
+    return max(-32767.0f, min(scaled, 32767.0f));
+}
+int Board::transmitBoardState(bool verbose) {
+    // pull data from the acquired snapshot
+    const BoardSnapshot& snap = snapshots[snapshot_front];
+    RfBoardState state = {};
+    state.state = curr_state;
+    if (curr_state == STATE_GAME) {
+        state.num_balls = min(snap.num_balls, RF_MAX_BALLS);
+        state.tick = snap.step & 0xFFFF;
+        for (int i = 0; i < state.num_balls; ++i) {
+            state.ball_x[i] = (int)snap.balls[i].x & 0xFF;
+            state.ball_y[i] = (int)snap.balls[i].y & 0xFFFF;
+            state.ball_vx[i] = rfVelocity(snap.balls[i].x_speed);
+            state.ball_vy[i] = rfVelocity(snap.balls[i].y_speed);
+        }
+        state.paddle_x[0] = snap.paddle_x[0] & 0xFF;
+        state.paddle_x[1] = snap.paddle_x[1] & 0xFF;
+        state.score[0] = snap.score1 & 0xFFFF;
+        state.score[1] = snap.score2 & 0xFFFF;
+    }
+    if (rf_keyframe_request.exchange(false)) { rf_encoder.reset(); }
+
+    // format the data under the configured protocol version; dynamic payloads
+    // (ACK payload mode) send only the encoded bytes, otherwise the rest is padding
+    uint8_t message[MASTER_TRANSFER_SIZE] = {0};
+    int length = rf_encoder.encode(state, message);
+    if (length == 0) { return 0; } // v3: the slave can predict this frame
+    if (!RF_ACK_PAYLOAD) { length = MASTER_TRANSFER_SIZE; }
+
+    // queue the data; 0 if the last frame is still going out
+    int bits_written = master.writeAsync(NRF24L01P_PIPE_P0, (char*)message, length);
+    if (bits_written > 0) { rf_encoder.commit(); }
+
+    if (verbose) {
+        printf("[Master] %d || ", bits_written);
+        for (int i = 0; i < length; ++i) {
+            printf("%02X ", message[i]);
+        }
+        printf("\n");
+    }
+
+    return bits_written;
+}
+void Board::requestKeyframe() { rf_keyframe_request = true; }
+int Board::processIncomingSlaveMessage(bool verbose) {
+    if (master.readable()) {
+        char slave_message[SLAVE_TRANSFER_SIZE] = {0};
+        int bits_read = master.read(NRF24L01P_PIPE_P0, slave_message, 1);
+        if (bits_read > 0) {
+            int slave_paddle_pos = slave_message[0] & 0xFF;
+            queueInput(INPUT_P2_MOVE_TO, slave_paddle_pos);
+        }
+        if (verbose) {
+            printf("[Slave] %d || ", bits_read);
+            for (int i = 0; i < 1; ++i) {
+                printf("%02X ", slave_message[i]);
+            }
+            printf("\n");
+        }
+        return bits_read;
+    }
+
+    return 0;
+}
+int Board::processIncomingMasterMessage(bool verbose, uint32_t now_ms) {
+    int bits_read = 0;
+    if (slave.readable()) {
+        char master_message[MASTER_TRANSFER_SIZE] = {0};
+        bits_read = slave.read(NRF24L01P_PIPE_P0, master_message, MASTER_TRANSFER_SIZE);
+
+        if (verbose) {
+            printf("[Master] %d || ", bits_read);
+            for (int i = 0; i < bits_read; ++i) {
+                printf("%02X ", master_message[i]);
+            }
+            printf("\n");
+        }
+
+        // a delta whose base was lost is dropped until the next keyframe
+        if (bits_read > 0 && rf_decoder.decode((const uint8_t*)master_message, bits_read)) {
+            const RfBoardState& state = rf_decoder.getState();
+            if (state.state == STATE_GAME) {
+                curr_state = STATE_GAME;
+                syncMasterClock(state.tick, now_ms);
+            } else if (state.state == STATE_PAUSE) {
+                curr_state = STATE_PAUSE;
+            } else if (state.state == STATE_MENU) {
+                curr_state = STATE_MENU;
+            }
+        }
+    }
+
+    // the board moves on between frames too
+    if (curr_state == STATE_GAME && rf_decoder.getState().state == STATE_GAME) {
+        showMasterState(now_ms);
+    } else {
+        rf_clock = false;
+    }
+    return bits_read;
+}
+// Slave side: the master tick now, from the tick of each frame as it arrives.
+// Small errors are taken in a share at a time so radio jitter doesn't shake
+// the board; a big one (a new match, a long gap) is taken at once.
+void Board::syncMasterClock(uint16_t tick, uint32_t now_ms) {
+    float estimate = rf_tick + (now_ms - rf_tick_ms) * (1000.0f / PHYSICS_STEP.count());
+    float whole = floorf(estimate);
+    float error = (int16_t)(tick - (uint16_t)(uint32_t)whole) - (estimate - whole);
+    if (!rf_clock || fabsf(error) > PHYSICS_HZ / 10) {
+        estimate += error;
+        rf_tracker.reset();
+    } else {
+        estimate += error * RF_CLOCK_GAIN;
+    }
+    rf_tick = fmodf(estimate + 65536.0f, 65536.0f);
+    rf_tick_ms = now_ms;
+    rf_clock = true;
+}
+// Slave side: rebuilds the balls where the tracker reckons they are now
+void Board::showMasterState(uint32_t now_ms) {
+    const RfBoardState& state = rf_decoder.getState();
+    float tick = rf_tick + (now_ms - rf_tick_ms) * (1000.0f / PHYSICS_STEP.count());
+    rf_tracker.update(state, fmodf(tick, 65536.0f));
+
+    // the goal flash the master's physics raised
+    if (state.score[0] > score1 || state.score[1] > score2) {
+        goal_ticker_counter = 0;
+        goal_ticker.attach(&GoalTickerCallback, 50ms);
+    }
+    score1 = state.score[0];
+    score2 = state.score[1];
+
+    // frame ball i stays in pool slot i, so the render's and the snapshot's
+    // per-slot history follows the same ball; one not shown is only hidden
+    float scale = RF_VELOCITY_SCALE * PHYSICS_STEP_SCALE;
+    for (int i = 0; i < MAX_NUM_OF_BALLS; i++) {
+        if (i < state.num_balls && rf_tracker.isShown(i)) {
+            balls.place(i, rf_tracker.getX(i), rf_tracker.getY(i), state.ball_vx[i] / scale, state.ball_vy[i] / scale);
+        } else {
+            balls.despawn(i);
+        }
+    }
+    // paddle 1 is the slave's own, moved by its buttons and sent back from
+    // there; the master's copy of it is a frame or more behind
+    paddles[0].moveTo(lroundf(rf_tracker.getPaddleX(0)));
+    publishSnapshot(now_ms);
+}
+int Board::transmitOutboundSlaveMessage(bool verbose) {
+    char message[1] = {0};
+    message[0] = paddles[1].getLeft() & 0xFF;
+    // either preloaded for the ACK of the next master message or sent on its own
+    int bits_written = RF_ACK_PAYLOAD ? slave.writeAckPayload(NRF24L01P_PIPE_P0, message, SLAVE_TRANSFER_SIZE)
+                                      : slave.writeAsync(NRF24L01P_PIPE_P0, message, SLAVE_TRANSFER_SIZE);
+
+    if (verbose) {
+        printf("[Slave] %d || ", bits_written);
+        for (int i = 0; i < SLAVE_TRANSFER_SIZE; ++i) {
+            printf("%02X ", message[i]);
+        }
+        printf("\n");
+    }
+
+    return bits_written;
+}
+void Board::incrementScore1() { score1++; }
+void Board::incrementScore2() { score2++; }
+int Board::getScore1() const { return score1; }
+int Board::getScore2() const { return score2; }
+
+void Board::resetGame() {
+    balls.clear();
+    balls.spawn(min_width+(max_width-min_width)/2, min_height+(max_height-min_height)/2);
+    // re-centred in place: the vector never reallocates after the constructor,
+    // so this is safe from an ISR and a Paddle& held elsewhere stays valid
+    for (Paddle& paddle : paddles) {
+        paddle.moveTo((int)((float)(max_width-min_width) / 2 - (0.15 * (max_width-min_width)) / 2));
+        paddle.invalidate();
+    }
+    score1 = 0;
+    score2 = 0;
+    ai.reset();
+}
+
+void Board::setAI1Enabled(bool enabled) {
+    ai1_enabled = enabled;
+}
+
+void Board::setAI2Enabled(bool enabled) {
+    ai2_enabled = enabled;
+}
+
+bool Board::getAI1Enabled() {
+    return ai1_enabled;
+}
+
+bool Board::getAI2Enabled() {
+    return ai2_enabled;
+}
+
+void Board::setWireless(bool enabled) {
+    wireless = enabled;
+}
+
+bool Board::getWireless() {
+    return wireless;
+}
+
+void Board::setBallCollisions(bool enabled) {
+    ball_collisions = enabled;
+}
+
+bool Board::getBallCollisions() {
+    return ball_collisions;
+}
+
+// BALL POOL METHODS
+
+BallPool::BallPool() {
+    radius = 3;
+    clear();
+}
+BallPool::~BallPool() {}
+
+int BallPool::spawn(phys_t x, phys_t y) {
+    if (numFree <= 0) { return -1; }
+    // rejection-sample a y speed of at least 0.8, four candidates per draw
+    phys_t y_speed = 0;
+    phys_t candidates[4];
+    while (abs(y_speed) < 0.8) {
+        randPhysBetween(-1.5, 1.5, candidates, 4);
+        for (int c = 0; c < 4 && abs(y_speed) < 0.8; c++) { y_speed = candidates[c]; }
+    }
+    phys_t sign = randPhysBetween(-0.5,0.5);
+    phys_t speed = randPhysBetween(1.5, 2.5);
+    phys_t x_speed = sqrt(abs(speed*speed-y_speed*y_speed));
+    if (sign < 0) { x_speed = -x_speed; }
+    return spawn(x, y, x_speed, y_speed);
+}
+int BallPool::spawn(phys_t x, phys_t y, phys_t x_speed, phys_t y_speed) {
+    if (numFree <= 0) { return -1; }
+    int i = freeList[--numFree];
+    aliveMask[i >> 5] |= (1u << (i & 31));
+
+    this->x[i] = x;
+    this->y[i] = y;
+    this->x_speed[i] = x_speed;
+    this->y_speed[i] = y_speed;
+    prevX[i] = x;
+    prevY[i] = y;
+    return i;
+}
+void BallPool::despawn(int i) {
+    if (!alive(i)) { return; }
+    aliveMask[i >> 5] &= ~(1u << (i & 31));
+    freeList[numFree++] = i;
+}
+// Puts a ball in slot i whether or not it was alive, for a caller that keeps
+// its own numbering (the slave mirroring the master's balls)
+void BallPool::place(int i, phys_t x, phys_t y, phys_t x_speed, phys_t y_speed) {
+    if (i < 0 || i >= MAX_NUM_OF_BALLS) { return; }
+    if (!alive(i)) {
+        for (int f = 0; f < numFree; f++) {
+            if (freeList[f] == i) { freeList[f] = freeList[--numFree]; break; }
+        }
+        aliveMask[i >> 5] |= (1u << (i & 31));
+    }
+    this->x[i] = x;
+    this->y[i] = y;
+    this->x_speed[i] = x_speed;
+    this->y_speed[i] = y_speed;
+    prevX[i] = x;
+    prevY[i] = y;
+}
+void BallPool::clear() {
+    for (int w = 0; w < BALL_POOL_WORDS; w++) { aliveMask[w] = 0; }
+    // lowest slots are handed out first
+    numFree = MAX_NUM_OF_BALLS;
+    for (int i = 0; i < MAX_NUM_OF_BALLS; i++) { freeList[i] = MAX_NUM_OF_BALLS - 1 - i; }
+}
+int BallPool::count() const { return MAX_NUM_OF_BALLS - numFree; }
+bool BallPool::alive(int i) const {
+    return i >= 0 && i < MAX_NUM_OF_BALLS && (aliveMask[i >> 5] & (1u << (i & 31)));
+}
+int BallPool::first() const { return next(-1); }
+int BallPool::next(int i) const {
+    i++;
+    if (i >= MAX_NUM_OF_BALLS) { return -1; }
+    int w = i >> 5;
+    uint32_t bits = aliveMask[w] & (0xFFFFFFFFu << (i & 31));
+    while (!bits) {
+        if (++w >= BALL_POOL_WORDS) { return -1; }
+        bits = aliveMask[w];
+    }
+    return (w << 5) + __builtin_ctz(bits);
+}
+float BallPool::getx(int i) const { return (float)x[i]; }
+float BallPool::gety(int i) const { return (float)y[i]; }
+float BallPool::getx_speed(int i) const { return (float)x_speed[i]; }
+float BallPool::gety_speed(int i) const { return (float)y_speed[i]; }
+float BallPool::getprevx(int i) const { return (float)prevX[i]; }
+float BallPool::getprevy(int i) const { return (float)prevY[i]; }
+int BallPool::getRadius() const { return radius; }
+
+// num/den for the slab test, clamped to [-1, 2] so nearly parallel motion
+// cannot overflow Q16.16 (anything outside [0, 1] misses the tick anyway)
+static phys_t sweepTime(phys_t num, phys_t den) {
+    if (abs(num) >= abs(den) * 2) { return ((num < 0) != (den < 0)) ? -1 : 2; }
+    return num / den;
+}
+
+// Swept test of the ball centre's path this tick against the paddle grown by
+// the ball radius vertically. On contact, t_hit is the fraction of the tick's
+// motion covered before the ball touches the paddle.
+static bool sweepPaddle(phys_t x, phys_t y, phys_t x_speed, phys_t y_speed, int radius, Paddle& paddle, phys_t& t_hit) {
+    phys_t left = paddle.getLeft();
+    phys_t right = paddle.getRight();
+    phys_t top = paddle.getTop() - radius;
+    phys_t bottom = paddle.getBottom() + radius;
+    phys_t t_enter = 0;
+    phys_t t_exit = 1;
+
+    if (x_speed == 0) {
+        if (x < left || x > right) { return false; }
+    } else {
+        phys_t t0 = sweepTime(left - x, x_speed);
+        phys_t t1 = sweepTime(right - x, x_speed);
+        t_enter = max(t_enter, min(t0, t1));
+        t_exit = min(t_exit, max(t0, t1));
+    }
+    if (y_speed == 0) {
+        if (y < top || y > bottom) { return false; }
+    } else {
+        phys_t t0 = sweepTime(top - y, y_speed);
+        phys_t t1 = sweepTime(bottom - y, y_speed);
+        t_enter = max(t_enter, min(t0, t1));
+        t_exit = min(t_exit, max(t0, t1));
+    }
+    if (t_enter > t_exit) { return false; }
+    t_hit = t_enter;
+    return true;
+}
+
+void BallPool::move(int i, Board& board, bool& delete_ball) {
+    phys_t& x = this->x[i];
+    phys_t& y = this->y[i];
+    phys_t& x_speed = this->x_speed[i];
+    phys_t& y_speed = this->y_speed[i];
+    const phys_t step = PHYSICS_STEP_SCALE;
+    delete_ball = false;
+    prevX[i] = x;
+    prevY[i] = y;
+
+    // paddles are swept so fast balls cannot tunnel through them between steps
+    phys_t t_hit;
+    if (y_speed < 0 && sweepPaddle(x, y, x_speed*step, y_speed*step, radius, board.paddles[0], t_hit)) {
+        x = x + x_speed*step*t_hit;
+        y = y + y_speed*step*t_hit;
+        phys_t jitter[2];
+        randPhysBetween(1, 1.05, jitter, 2);
+        y_speed = abs(y_speed)*jitter[0];
+        x_speed = x_speed*jitter[1];
+        if (abs(x_speed) < 0.5) { x_speed+=randPhysBetween(-0.5, 0.5); }
+        x = x + x_speed*step*(1 - t_hit);
+        y = y + y_speed*step*(1 - t_hit);
+    } else if (y_speed > 0 && sweepPaddle(x, y, x_speed*step, y_speed*step, radius, board.paddles[1], t_hit)) {
+        x = x + x_speed*step*t_hit;
+        y = y + y_speed*step*t_hit;
+        phys_t jitter[2];
+        randPhysBetween(1, 1.05, jitter, 2);
+        y_speed = -abs(y_speed)*jitter[0];
+        x_speed = x_speed*jitter[1];
+        if (abs(x_speed) < 0.5) { x_speed+=randPhysBetween(-0.5, 0.5); }
+        x = x + x_speed*step*(1 - t_hit);
+        y = y + y_speed*step*(1 - t_hit);
+    } else {
+        x = x + x_speed*step;
+        y = y + y_speed*step;
+    }
+
+    if (y-radius <= board.getMinHeight()) {
+        board.incrementScore2();
+        goal_ticker_counter = 0;
+        goal_ticker.attach(&GoalTickerCallback, 50ms);
+        delete_ball = true;
+    } else if (y+radius >= board.getMaxHeight()) {
+        board.incrementScore1();
+        goal_ticker_counter = 0;
+        goal_ticker.attach(&GoalTickerCallback, 50ms);
+        delete_ball = true;
+    } else if (x-radius <= board.getMinWidth()) {
+        x_speed = abs(x_speed);
+        x = abs(x-board.getMinWidth()) + board.getMinWidth();
+        x = max(board.getMinWidth()+radius, x);
+    } else if (x+radius >= board.getMaxWidth()) {
+        x_speed = -abs(x_speed);
+        x = board.getMaxWidth() - abs(x-board.getMaxWidth());
+        x = min(board.getMaxWidth()-radius, x);
+    }
+}
+void BallPool::collide(Board& board) {
+    int cols = min((board.getMaxWidth() - board.getMinWidth() + (1 << BROADPHASE_CELL_SHIFT) - 1) >> BROADPHASE_CELL_SHIFT, BROADPHASE_MAX_COLS);
+    int rows = min((board.getMaxHeight() - board.getMinHeight() + (1 << BROADPHASE_CELL_SHIFT) - 1) >> BROADPHASE_CELL_SHIFT, BROADPHASE_MAX_ROWS);
+    int num_cells = cols * rows;
+
+    // bin every live ball into its grid cell
+    for (int c = 0; c <= num_cells; c++) { cellStart[c] = 0; }
+    for (int i = first(); i >= 0; i = next(i)) {
+        int cx = max(0, min(((int)round(x[i]) - board.getMinWidth()) >> BROADPHASE_CELL_SHIFT, cols - 1));
+        int cy = max(0, min(((int)round(y[i]) - board.getMinHeight()) >> BROADPHASE_CELL_SHIFT, rows - 1));
+        ballCell[i] = cy * cols + cx;
+        cellStart[ballCell[i] + 1]++;
+    }
+    for (int c = 0; c < num_cells; c++) { cellStart[c + 1] += cellStart[c]; }
+    for (int i = first(); i >= 0; i = next(i)) {
+        cellBalls[cellStart[ballCell[i]]++] = i;
+    }
+    // the scatter advanced each start to the next cell's start, shift back
+    for (int c = num_cells; c > 0; c--) { cellStart[c] = cellStart[c - 1]; }
+    cellStart[0] = 0;
+
+    // narrowphase against the 3x3 neighbourhood, each pair tested once
+    for (int i = first(); i >= 0; i = next(i)) {
+        int cx = ballCell[i] % cols;
+        int cy = ballCell[i] / cols;
+        for (int ny = max(cy - 1, 0); ny <= min(cy + 1, rows - 1); ny++) {
+            for (int nx = max(cx - 1, 0); nx <= min(cx + 1, cols - 1); nx++) {
+                int c = ny * cols + nx;
+                for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+                    if (cellBalls[k] > i) { collidePair(i, cellBalls[k]); }
+                }
+            }
+        }
+    }
+}
+void BallPool::collidePair(int i, int j) {
+    phys_t dx = x[j] - x[i];
+    phys_t dy = y[j] - y[i];
+    phys_t dist2 = dx*dx + dy*dy;
+    phys_t reach = 2 * radius;
+    if (dist2 >= reach*reach || dist2 == 0) { return; }
+
+    // equal-mass elastic bounce: exchange the velocity components along the
+    // line of centres, but only while the balls are still approaching
+    phys_t dot = (x_speed[j] - x_speed[i])*dx + (y_speed[j] - y_speed[i])*dy;
+    if (dot >= 0) { return; }
+    phys_t k = dot / dist2;
+    x_speed[i] += k*dx;
+    y_speed[i] += k*dy;
+    x_speed[j] -= k*dx;
+    y_speed[j] -= k*dy;
+}
+
+// DIRTY RECTANGLE METHODS
+
+DirtyRects::DirtyRects() : count(0) {}
+
+static bool touches(const DirtyRect& a, const DirtyRect& b) {
+    return a.x0 <= b.x1 && b.x0 <= a.x1 && a.y0 <= b.y1 && b.y0 <= a.y1;
+}
+static DirtyRect unite(const DirtyRect& a, const DirtyRect& b) {
+    DirtyRect r = {min(a.x0, b.x0), min(a.y0, b.y0), max(a.x1, b.x1), max(a.y1, b.y1)};
+    return r;
+}
+static int area(const DirtyRect& r) {
+    return (r.x1 - r.x0) * (r.y1 - r.y0);
+}
+
+// Adds a region, absorbing every rect it touches. The union can reach rects
+// the original did not, so absorption repeats until nothing touches. When the
+// list is full the region is folded into whichever rect grows the least.
+void DirtyRects::add(int x, int y, int width, int height) {
+    if (width <= 0 || height <= 0) { return; }
+    DirtyRect r = {(int16_t)x, (int16_t)y, (int16_t)(x + width), (int16_t)(y + height)};
+    while (true) {
+        int hit = -1;
+        for (int i = 0; i < count && hit < 0; i++) {
+            if (touches(r, rects[i])) { hit = i; }
+        }
+        if (hit < 0 && count < DIRTY_MAX_RECTS) { break; }
+        if (hit < 0) {
+            int growth = INT32_MAX;
+            for (int i = 0; i < count; i++) {
+                int g = area(unite(r, rects[i])) - area(rects[i]);
+                if (g < growth) {
+                    growth = g;
+                    hit = i;
+                }
+            }
+        }
+        r = unite(r, rects[hit]);
+        rects[hit] = rects[--count];
+    }
+    rects[count++] = r;
+}
+void DirtyRects::addAll(const DirtyRects& other) {
+    for (int i = 0; i < other.count; i++) {
+        const DirtyRect& r = other.rects[i];
+        add(r.x0, r.y0, r.x1 - r.x0, r.y1 - r.y0);
+    }
+}
+void DirtyRects::clear() { count = 0; }
+int DirtyRects::size() const { return count; }
+const DirtyRect& DirtyRects::get(int i) const { return rects[i]; }
+
+// PADDLE OBJECT METHODS
+
+Paddle::Paddle(int x, int y, Board& board) : x(x), y(y), board(board) {
+    height = 5;
+    width = 0.15 * (board.getMaxWidth()-board.getMinWidth());
+    lastDrawnX = x;
+    lastDrawnY = y;
+    invalidated = true;
+}
+Paddle::~Paddle() {}
+
+int Paddle::getLeft() {
+    return x;
+}
+int Paddle::getRight() {
+    return x+width;
+}
+int Paddle::getTop() {
+    return y;
+}
+int Paddle::getBottom() {
+    return y+height;
+}
+// Marks the paddle's old and new footprint dirty if it moved to x (its left
+// edge) since it was last drawn
+void Paddle::markDirty(int x, DirtyRects& dirty) {
+    if (!invalidated && x == lastDrawnX && y == lastDrawnY) {
+        return;
+    }
+    dirty.add(lastDrawnX, lastDrawnY, width, height);
+    dirty.add(x, y, width, height);
+    lastDrawnX = x;
+    lastDrawnY = y;
+    invalidated = false;
+}
+// Draws the part of the paddle that falls inside clip
+void Paddle::drawClipped(const DirtyRect& clip) {
+    if (GFX_USE_SPRITES) {
+        gfxDrawSprite(GFX_SPRITE_PADDLE, lastDrawnX, lastDrawnY, clip.x0, clip.y0, clip.x1, clip.y1);
+        return;
+    }
+    int x0 = max(lastDrawnX, (int)clip.x0);
+    int y0 = max(lastDrawnY, (int)clip.y0);
+    int x1 = min(lastDrawnX + width, (int)clip.x1);
+    int y1 = min(lastDrawnY + height, (int)clip.y1);
+    if (x0 < x1 && y0 < y1) {
+        gfxFillRect(x0, y0, x1 - x0, y1 - y0, LCD_COLOR_WHITE);
+    }
+}
+void Paddle::invalidate() {
+    invalidated = true;
+}
+void Paddle::moveRight() {
+    if (x+width <= board.getMaxWidth()) {
+        x = x + 0.25*width;
+        x = min(x, board.getMaxWidth()-width);
+    }
+}
+void Paddle::moveLeft() {
+    if (x > board.getMinWidth()) {
+        x = x - 0.25*width;
+        x = max(board.getMinWidth(), x);
+    }
+}
+void Paddle::moveTo(int new_x) {
+    x = max(board.getMinWidth(), min(new_x, board.getMaxWidth() - width));
+}
+
+// HELPER FUNCTIONS ------------------------
+
+float min(float a, float b) {
+    return a > b ? b : a;
+}
+
+float max(float a, float b) {
+    return a < b ? b : a;
+}
+
+// Game RNG: xoshiro128** so matches are reproducible and a draw never waits
+// on the hardware. Seeded from the hardware RNG at boot and at the start of
+// every match; the 32-bit seed is spread over the 128-bit state by splitmix32.
+static uint32_t game_rng[4] = {0x9E3779B9, 0x243F6A88, 0xB7E15162, 0x2545F491};
+
+static inline uint32_t rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+void gameSeed(uint32_t seed) {
+    for (int i = 0; i < 4; i++) {
+        uint32_t z = (seed += 0x9E3779B9);
+        z = (z ^ (z >> 16)) * 0x85EBCA6B;
+        z = (z ^ (z >> 13)) * 0xC2B2AE35;
+        game_rng[i] = z ^ (z >> 16);
+    }
+}
+
+// Works on a local copy of the state so batched callers keep it in registers
+static inline uint32_t xoshiro128ss(uint32_t& s0, uint32_t& s1, uint32_t& s2, uint32_t& s3) {
+    uint32_t result = rotl(s1 * 5, 7) * 9;
+    uint32_t t = s1 << 9;
+    s2 ^= s0;
+    s3 ^= s1;
+    s1 ^= s2;
+    s0 ^= s3;
+    s2 ^= t;
+    s3 = rotl(s3, 11);
+    return result;
+}
+
+uint32_t gameRandom() {
+    return xoshiro128ss(game_rng[0], game_rng[1], game_rng[2], game_rng[3]);
+}
+
+// Top 24 bits as a float in [0, 1), exact with no division
+static inline float unitFloat(uint32_t r) {
+    return (r >> 8) * (1.0f / 16777216.0f);
+}
+
+float randBetween(float min, float max) {
+    return unitFloat(gameRandom()) * (max-min) + min;
+}
+
+// Fills out[0..n) with samples in [min, max), one state load/store per batch
+void randBetween(float min, float max, float* out, int n) {
+    uint32_t s0 = game_rng[0], s1 = game_rng[1], s2 = game_rng[2], s3 = game_rng[3];
+    float span = max - min;
+    for (int i = 0; i < n; i++) { out[i] = unitFloat(xoshiro128ss(s0, s1, s2, s3)) * span + min; }
+    game_rng[0] = s0; game_rng[1] = s1; game_rng[2] = s2; game_rng[3] = s3;
+}
+
+#if FIXED_POINT_PHYSICS
+phys_t randPhysBetween(phys_t min, phys_t max) {
+    phys_t out;
+    randPhysBetween(min, max, &out, 1);
+    return out;
+}
+void randPhysBetween(phys_t min, phys_t max, phys_t* out, int n) {
+    // 16 random fraction bits scaled into [min, max) with integer math only
+    uint32_t s0 = game_rng[0], s1 = game_rng[1], s2 = game_rng[2], s3 = game_rng[3];
+    int64_t span = (int64_t)(max.raw - min.raw);
+    for (int i = 0; i < n; i++) {
+        uint32_t r = xoshiro128ss(s0, s1, s2, s3) >> 16;
+        out[i] = Fix16::fromRaw(min.raw + (int32_t)((r * span) >> FIX16_FRAC_BITS));
+    }
+    game_rng[0] = s0; game_rng[1] = s1; game_rng[2] = s2; game_rng[3] = s3;
+}
+#else
+phys_t randPhysBetween(phys_t min, phys_t max) {
+    return randBetween(min, max);
+}
+void randPhysBetween(phys_t min, phys_t max, phys_t* out, int n) {
+    randBetween(min, max, out, n);
+}
+#endif
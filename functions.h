@@ -2,13 +2,203 @@
 #define FUNCTIONS_H
 
 #include "mbed.h"
+#include "LCD_DISCO_F429ZI.h"
+#include "nRF24L01P.h"
+#include "fixed.h"
+#include "replay.h"
+#include "rf_protocol.h"
+#include "gfx.h"
 #include <vector>
+#include <atomic>
+
+#define MASTER 1 // 1 for master, 0 for slave
+#define MASTER_TRANSFER_SIZE 32 // 30 byte RF payload
+#define SLAVE_TRANSFER_SIZE 1 // 1 byte RF payload
+#ifndef RF_IRQ_PIN
+#define RF_IRQ_PIN PE_4 // nRF24L01+ IRQ line (EXTI4 is free), NC to poll STATUS instead
+#endif
+#ifndef RF_ACK_PAYLOAD
+#define RF_ACK_PAYLOAD 1 // 1 for the slave's paddle byte to ride on the ACK of each master message, 0 for its own packet
+#endif
+#define RF_ACK_DELAY_US 500 // auto retransmit delay, enough for an ACK payload at any data rate
+#define RF_ACK_RETRIES 2 // retransmits before a master message is dropped; the next frame supersedes it anyway
+#define RF_CLOCK_GAIN 0.25f // share of the slave's master tick estimate error corrected per frame
+#ifndef PHYSICS_HZ
+#define PHYSICS_HZ 200 // fixed simulation rate of the physics thread
+#endif
+#define PHYSICS_STEP std::chrono::microseconds(1000000 / PHYSICS_HZ) // what the physics thread steps by
+#define PHYSICS_MAX_CATCHUP (PHYSICS_STEP * 10) // simulated time dropped after a longer stall
+#define BALL_SPEED_HZ 50 // ball speeds are in px per tick at this rate
+#define PHYSICS_STEP_SCALE ((double)BALL_SPEED_HZ * PHYSICS_STEP.count() / 1000000) // from PHYSICS_STEP, so game speed matches the real step
+#define AI_HZ 50 // rate the AI paddles get to react
+#ifndef REPLAY_RECORD
+#define REPLAY_RECORD 0 // 1 to log every match and dump it over serial when it ends
+#endif
+#define AI1_DIFFICULTY 1 // 0 is easy, 10 is hard (top paddle)
+#define AI2_DIFFICULTY 3 // 0 is easy, 10 is hard (bottom paddle)
+#define AI_MIN_LATENCY_MS 20  // reaction time at difficulty 10
+#define AI_MAX_LATENCY_MS 320 // reaction time at difficulty 0
+#define AI_MAX_ERROR 1.0f     // aim error at difficulty 0, in paddle widths
+#ifndef FIXED_POINT_PHYSICS
+#define FIXED_POINT_PHYSICS 0 // 1 for Q16.16 fixed-point ball physics, 0 for float
+#endif
+#ifndef MAX_NUM_OF_BALLS
+#define MAX_NUM_OF_BALLS 8 // capacity of the ball pool, fixed at compile time
+#endif
+#define BALL_POOL_WORDS ((MAX_NUM_OF_BALLS + 31) / 32)
+#define BROADPHASE_CELL_SHIFT 3 // 8 px grid cells, wider than a ball diameter
+#define BROADPHASE_MAX_COLS 32 // enough for a 256 px wide playfield
+#define BROADPHASE_MAX_ROWS 40 // enough for a 320 px tall playfield
+#define DIRTY_MAX_RECTS 16 // regions tracked per frame before they get folded together
+#define SNAPSHOT_FRESH 0x80 // set on the hand-off snapshot index until the reader takes it
+
+#if FIXED_POINT_PHYSICS
+typedef Fix16 phys_t;
+#else
+typedef float phys_t;
+#endif
 
 // Forward Declarations
-class Ball;
+class BallPool;
+class PongAI;
 class Paddle;
 class Board;
 
+// Data Types
+typedef enum {
+    STATE_MENU = 0,
+    STATE_PAUSE = 1,
+    STATE_GAME = 2,
+} StateType;
+
+// Devices and shared state (defined in main.cpp, or host/host_hal.cpp off-target)
+extern LCD_DISCO_F429ZI LCD;
+extern nRF24L01P master;
+extern nRF24L01P slave;
+extern Ticker goal_ticker;
+extern StateType curr_state;
+extern int goal_ticker_counter;
+
+// Ball Pool Class
+// Structure-of-arrays storage for every ball on the board. Slots are handed out
+// from a free list and tracked in an alive bitmask, so spawning and despawning
+// are O(1) and nothing is allocated after boot.
+class BallPool {
+private:
+    phys_t x[MAX_NUM_OF_BALLS];
+    phys_t y[MAX_NUM_OF_BALLS];
+    phys_t x_speed[MAX_NUM_OF_BALLS];
+    phys_t y_speed[MAX_NUM_OF_BALLS];
+    phys_t prevX[MAX_NUM_OF_BALLS];
+    phys_t prevY[MAX_NUM_OF_BALLS];
+    uint32_t aliveMask[BALL_POOL_WORDS];
+    uint16_t freeList[MAX_NUM_OF_BALLS];
+    int numFree;
+    int radius;
+    // uniform grid broadphase, rebuilt by a counting sort on every collide()
+    uint16_t cellStart[BROADPHASE_MAX_COLS * BROADPHASE_MAX_ROWS + 1];
+    uint16_t cellBalls[MAX_NUM_OF_BALLS];
+    uint16_t ballCell[MAX_NUM_OF_BALLS];
+    void collidePair(int i, int j);
+public:
+    BallPool();
+    ~BallPool();
+    int spawn(phys_t x, phys_t y);
+    int spawn(phys_t x, phys_t y, phys_t x_speed, phys_t y_speed);
+    void despawn(int i);
+    void place(int i, phys_t x, phys_t y, phys_t x_speed, phys_t y_speed);
+    void clear();
+    int count() const;
+    bool alive(int i) const;
+    int first() const;
+    int next(int i) const;
+    float getx(int i) const;
+    float gety(int i) const;
+    float getx_speed(int i) const;
+    float gety_speed(int i) const;
+    float getprevx(int i) const;
+    float getprevy(int i) const;
+    int getRadius() const;
+    void move(int i, Board& board, bool& del);
+    void collide(Board& board);
+};
+
+// Pong AI Class
+// Drives the AI paddles from predicted intercepts. Each incoming ball's landing
+// x on the paddle line is solved in closed form, walls unfolded, and cached
+// until the ball's velocity changes. A paddle goes for the ball that lands
+// first. Difficulty sets how long a new prediction takes to be acted on and how
+// far off the aim is.
+class PongAI {
+private:
+    float interceptX[MAX_NUM_OF_BALLS];
+    float aimError[MAX_NUM_OF_BALLS]; // -1..1, scaled by the paddle's max error
+    float keyXSpeed[MAX_NUM_OF_BALLS]; // |x speed| and y speed the prediction was made for;
+    float keyYSpeed[MAX_NUM_OF_BALLS]; // wall bounces only flip x so they keep it valid
+    uint32_t predictedAt[MAX_NUM_OF_BALLS];
+    uint32_t tick;
+    uint32_t latency[2];
+    float maxError[2];
+    float target[2];
+    uint32_t predictions;
+    float paddleLine(Board& board, const BallPool& balls, int paddle) const;
+    float predictIntercept(Board& board, const BallPool& balls, int i, float line) const;
+public:
+    PongAI();
+    void reset();
+    void setDifficulty(int paddle, int difficulty);
+    void update(Board& board, const BallPool& balls, bool enabled1, bool enabled2);
+    float getTarget(int paddle) const;
+    uint32_t getPredictions() const;
+};
+
+// Dirty Rectangle Tracker
+// Screen regions that changed this frame, kept as half-open [x0, x1) x [y0, y1)
+// rects. Overlapping or touching rects are merged on insert, so each pixel is
+// repainted at most once per flush.
+struct DirtyRect {
+    int16_t x0;
+    int16_t y0;
+    int16_t x1;
+    int16_t y1;
+};
+
+class DirtyRects {
+private:
+    DirtyRect rects[DIRTY_MAX_RECTS];
+    int count;
+public:
+    DirtyRects();
+    void add(int x, int y, int width, int height);
+    void addAll(const DirtyRects& other);
+    void clear();
+    int size() const;
+    const DirtyRect& get(int i) const;
+};
+
+// Board Snapshot
+// Copy of everything the render loop and the radio need from one physics step.
+// The physics thread publishes these through a lock-free triple buffer.
+struct BallState {
+    uint16_t slot;
+    float x;
+    float y;
+    float prevX;
+    float prevY;
+    float x_speed;
+    float y_speed;
+};
+
+struct BoardSnapshot {
+    BallState balls[MAX_NUM_OF_BALLS];
+    int num_balls;
+    int paddle_x[2];
+    int score1;
+    int score2;
+    uint32_t time_ms;
+    uint32_t step;
+};
+
 // Board Class
 class Board {
 private:
@@ -16,13 +206,54 @@ private:
     int max_height;
     int min_width;
     int max_width;
-    std::vector<Ball> balls;
-    int maxNumOfBalls = 8;
+    BallPool balls;
+    int maxNumOfBalls = MAX_NUM_OF_BALLS;
     int score1;
     int score2;
     bool ai1_enabled;
     bool ai2_enabled;
     bool wireless;
+    bool ball_collisions;
+    int ai_step_counter;
+    PongAI ai;
+    // triple buffer: back is written by the producer, front is read by the
+    // consumer, and the two swap through middle with a single atomic exchange
+    BoardSnapshot snapshots[3];
+    uint8_t snapshot_back;
+    uint8_t snapshot_front;
+    std::atomic<uint8_t> snapshot_middle;
+    // render-side record of where each ball slot was last drawn
+    int16_t drawnX[MAX_NUM_OF_BALLS];
+    int16_t drawnY[MAX_NUM_OF_BALLS];
+    uint32_t drawnMask[BALL_POOL_WORDS];
+    int drawnScore1;
+    int drawnScore2;
+    bool force_redraw;
+    bool double_buffered;
+    DirtyRects dirty;
+    DirtyRects previous_dirty;
+    void drawScoreboard();
+    // inputs raised by ISRs and the radio, applied by the physics thread at the
+    // start of the next step so a match can be replayed step for step
+    std::atomic<uint8_t> pending_inputs[NUM_INPUTS];
+    std::atomic<int16_t> pending_p2_pos;
+    std::atomic<bool> pending_match;
+    std::atomic<uint32_t> pending_seed;
+    uint32_t step_count;
+    ReplayRecorder* recorder;
+    void applyInputs();
+    // master messages (rf_protocol.h); a dropped one asks for the next to be
+    // a keyframe. The slave reckons the master's tick from the frames' ticks
+    // and shows the board through rf_tracker.
+    RfFrameEncoder rf_encoder;
+    RfFrameDecoder rf_decoder;
+    std::atomic<bool> rf_keyframe_request;
+    RfBallTracker rf_tracker;
+    float rf_tick;
+    uint32_t rf_tick_ms;
+    bool rf_clock;
+    void syncMasterClock(uint16_t tick, uint32_t now_ms);
+    void showMasterState(uint32_t now_ms);
 public:
     Board(int min_width, int min_height, int max_width, int max_height);
     ~Board();
@@ -30,9 +261,23 @@ public:
     int getMinWidth() const;
     int getMaxHeight() const;
     int getMaxWidth() const;
-    void spawnBall();
-    void drawBalls();
+    int getBallRadius() const;
+    int getNumBalls() const;
+    bool spawnBall();
+    void render(float alpha);
+    void invalidate();
+    void setDoubleBuffered(bool enabled);
+    void publishSnapshot(uint32_t time_ms);
+    const BoardSnapshot& acquireSnapshot();
+    const BoardSnapshot& getSnapshot() const;
     void moveBalls();
+    void step();
+    uint32_t getStepCount() const;
+    void queueInput(InputType type, uint8_t arg = 0);
+    void requestMatch(uint32_t seed);
+    void startMatch(uint32_t seed);
+    void endMatch();
+    void setRecorder(ReplayRecorder* recorder);
     void incrementScore1();
     void incrementScore2();
     int getScore1() const;
@@ -44,35 +289,16 @@ public:
     bool getAI2Enabled();
     void setWireless(bool enabled);
     bool getWireless();
+    void setBallCollisions(bool enabled);
+    bool getBallCollisions();
     std::vector<Paddle> paddles;
     int transmitBoardState(bool verbose);
+    void requestKeyframe();
     int processIncomingSlaveMessage(bool verbose);
-    int processIncomingMasterMessage(bool verbose);
+    int processIncomingMasterMessage(bool verbose, uint32_t now_ms);
     int transmitOutboundSlaveMessage(bool verbose);
 };
 
-// Ball Class
-class Ball {
-private:
-    float x;
-    float y;
-    int radius;
-    float x_speed;
-    float y_speed;
-    int lastDrawnX;
-    int lastDrawnY;
-public:
-    Ball(float x, float y);
-    ~Ball();
-    float getx();
-    float gety();
-    float gety_speed();
-    int getLastDrawnX();
-    int getLastDrawnY();
-    void draw();
-    void move(Board& board, bool& del);
-};
-
 // Paddle Class
 class Paddle {
 private:
@@ -82,6 +308,7 @@ private:
     int width;
     int lastDrawnX;
     int lastDrawnY;
+    bool invalidated;
     Board& board;
 public:
     Paddle(int x, int y, Board& board);
@@ -90,7 +317,9 @@ public:
     int getRight();
     int getTop();
     int getBottom();
-    void draw();
+    void markDirty(int x, DirtyRects& dirty);
+    void drawClipped(const DirtyRect& clip);
+    void invalidate();
     void moveRight();
     void moveLeft();
     void moveTo(int new_x);
@@ -104,7 +333,6 @@ void ExternalButton4ISR();
 void ExternalButton5ISR();
 void ExternalButton6ISR();
 void OnboardButtonISR();
-void TickerISR();
 void GoalTickerCallback();
 
 // State Machine Setup
@@ -113,13 +341,21 @@ void statePause();
 void stateGame();
 void initializeSM();
 void initializeRF();
+void PhysicsThread();
 
 // Helper Functions
 float min(float a, float b);
 float max(float a, float b);
+void gameSeed(uint32_t seed);
+uint32_t gameRandom();
 float randBetween(float min, float max);
+void randBetween(float min, float max, float* out, int n);
+phys_t randPhysBetween(phys_t min, phys_t max);
+void randPhysBetween(phys_t min, phys_t max, phys_t* out, int n);
 void rngInit();
 uint32_t rngGetRandomNumber();
+uint32_t nowMs();
 void logRfDiagnostics();
+void drawOverlays();
 
 #endif // FUNCTION_H
\ No newline at end of file
@@ -0,0 +1,258 @@
+#include "gfx.h"
+#include <string.h>
+#include "functions.h"
+#include "dma2d.h"
+#include "display.h"
+#include "stats.h"
+
+#define GFX_ATLAS (LCD_FRAME_BUFFER + 0x300000) // sprite atlas in SDRAM, clear of both frame buffers
+#define GFX_GLYPH_CACHE (GFX_ATLAS + GFX_NUM_SPRITES * GFX_SPRITE_MAX_BYTES)
+#define GFX_SWATCHES (GFX_GLYPH_CACHE + GFX_GLYPH_CACHE_SLOTS * GFX_GLYPH_SLOT_BYTES) // L8 only: one solid screen per palette entry
+
+struct SpriteInfo {
+    uint32_t address;
+    int width;
+    int height;
+    bool blend;
+};
+
+static SpriteInfo sprites[GFX_NUM_SPRITES];
+
+// What each glyph cache slot holds; a zeroed slot is empty and ages out first
+struct GlyphSlot {
+    const sFONT* font;
+    uint32_t color;
+    uint32_t backColor;
+    uint32_t lastUsed;
+    uint8_t ch;
+};
+
+static GlyphSlot glyphs[GFX_GLYPH_CACHE_SLOTS];
+static uint32_t glyph_clock = 0;
+
+// DMA2D cannot fill in L8, so there a fill is a copy out of a solid swatch
+// of the colour; that still moves half the bytes of an ARGB8888 fill
+static void fillRect(int x, int y, int width, int height, uint32_t color) {
+    int pitch = BSP_LCD_GetXSize();
+    uint32_t dst = display.drawAddress() + GFX_BYTES_PER_PIXEL * (y * pitch + x);
+#if GFX_PIXEL_FORMAT == GFX_FORMAT_L8
+    uint32_t swatch = GFX_SWATCHES + gfxColor(color) * pitch * BSP_LCD_GetYSize();
+    dma2d.copy(swatch, pitch - width, dst, pitch - width, width, height);
+#else
+    dma2d.fill(dst, pitch - width, width, height, gfxColor(color));
+#endif
+}
+
+void gfxFillRect(int x, int y, int width, int height, uint32_t color) {
+    if (width <= 0 || height <= 0) { return; }
+    stats.countDraw(width * height, 1);
+    fillRect(x, y, width, height, color);
+}
+
+// One span per row. Small circles are a handful of short rows, cheaper as
+// CPU stores than as DMA2D transfers, so they wait for the queue and write
+// the frame directly; large ones go out as one batch of row fills.
+void gfxFillCircle(int x, int y, int radius, uint32_t color) {
+    int pitch = BSP_LCD_GetXSize();
+    int height = BSP_LCD_GetYSize();
+    int y0 = max(y - radius, 0);
+    int y1 = min(y + radius, height - 1);
+    if (radius > GFX_CPU_CIRCLE_RADIUS) {
+        int pixels = 0;
+        for (int row = y0; row <= y1; row++) {
+            int w = gfxCircleHalfWidth(radius, row - y);
+            int x0 = max(x - w, 0);
+            int x1 = min(x + w, pitch - 1);
+            if (x0 > x1) { continue; }
+            fillRect(x0, row, x1 - x0 + 1, 1, color);
+            pixels += x1 - x0 + 1;
+        }
+        stats.countDraw(pixels, y1 - y0 + 1);
+        return;
+    }
+    gfxSync();
+    gfx_pixel_t pixel = gfxColor(color);
+    gfx_pixel_t* frame = (gfx_pixel_t*)display.drawAddress();
+    int pixels = 0;
+    for (int row = y0; row <= y1; row++) {
+        int w = gfxCircleHalfWidth(radius, row - y);
+        int x0 = max(x - w, 0);
+        int x1 = min(x + w, pitch - 1);
+        gfx_pixel_t* p = frame + row * pitch;
+        for (int col = x0; col <= x1; col++) { p[col] = pixel; }
+        pixels += max(x1 - x0 + 1, 0);
+    }
+    stats.countDraw(pixels, 0);
+}
+
+void gfxSync() {
+    dma2d.sync();
+}
+
+// Primitives draw into the overlay page until gfxEndOverlay(). Queued
+// transfers keep their own addresses, so no sync is needed either way.
+void gfxBeginOverlay(GfxOverlay overlay) {
+    display.drawOverlay(overlay);
+}
+
+void gfxEndOverlay() {
+    display.drawOverlay(-1);
+}
+
+// Returns the SDRAM address of the frame-format tile for ch, expanding the font's
+// 1 bpp bitmap into the least recently used slot on a miss
+static uint32_t glyphTile(sFONT* font, uint8_t ch, uint32_t color, uint32_t back_color) {
+    int victim = 0;
+    for (int i = 0; i < GFX_GLYPH_CACHE_SLOTS; i++) {
+        GlyphSlot& g = glyphs[i];
+        if (g.font == font && g.ch == ch && g.color == color && g.backColor == back_color) {
+            g.lastUsed = ++glyph_clock;
+            return GFX_GLYPH_CACHE + i * GFX_GLYPH_SLOT_BYTES;
+        }
+        if (g.lastUsed < glyphs[victim].lastUsed) { victim = i; }
+    }
+
+    gfxSync(); // a queued blit may still be reading the slot being replaced
+    GlyphSlot& g = glyphs[victim];
+    g = {font, color, back_color, ++glyph_clock, ch};
+    gfx_pixel_t fg = gfxColor(color);
+    gfx_pixel_t bg = gfxColor(back_color);
+    gfx_pixel_t* p = (gfx_pixel_t*)(GFX_GLYPH_CACHE + victim * GFX_GLYPH_SLOT_BYTES);
+    int width = font->Width;
+    int row_bytes = (width + 7) / 8;
+    int offset = 8 * row_bytes - width;
+    const uint8_t* bitmap = &font->table[(ch - ' ') * font->Height * row_bytes];
+    for (int row = 0; row < font->Height; row++) {
+        const uint8_t* b = bitmap + row * row_bytes;
+        uint32_t line = row_bytes == 1 ? b[0] : row_bytes == 2 ? (b[0] << 8) | b[1] : (b[0] << 16) | (b[1] << 8) | b[2];
+        for (int col = 0; col < width; col++) {
+            *p++ = (line & (1u << (width - col + offset - 1))) ? fg : bg;
+        }
+    }
+    return GFX_GLYPH_CACHE + victim * GFX_GLYPH_SLOT_BYTES;
+}
+
+// Draws text one DMA2D copy per character from the glyph cache. Placement
+// matches BSP_LCD_DisplayStringAt, including how it centres and truncates.
+void gfxDrawString(int x, int y, const char* text, sFONT* font, uint32_t color, uint32_t back_color, Text_AlignModeTypdef mode) {
+    int pitch = BSP_LCD_GetXSize();
+    int length = strlen(text);
+    int columns = pitch / font->Width;
+    if (mode == CENTER_MODE) {
+        x += (columns - length) * font->Width / 2;
+    } else if (mode == RIGHT_MODE) {
+        x += (columns - length) * font->Width;
+    }
+    if (y < 0 || y + font->Height > (int)BSP_LCD_GetYSize()) { return; }
+    int drawn = 0;
+    for (int i = 0; text[i] && (i + 1) * font->Width <= pitch; i++, x += font->Width) {
+        uint8_t ch = text[i];
+        if (ch < ' ' || ch > '~' || x < 0 || x + font->Width > pitch) { continue; }
+        uint32_t tile = glyphTile(font, ch, color, back_color);
+        dma2d.copy(tile, 0, display.drawAddress() + GFX_BYTES_PER_PIXEL * (y * pitch + x), pitch - font->Width, font->Width, font->Height);
+        drawn++;
+    }
+    stats.countDraw(drawn * font->Width * font->Height, drawn);
+}
+
+// Pre-renders the ball and paddle into the SDRAM atlas once at boot, so each
+// is drawn with a single DMA2D transfer instead of being rasterised per frame.
+// The ball stays ARGB8888 for its alpha; the paddle is in the frame format.
+void gfxBuildSprites(int ball_radius, int paddle_width, int paddle_height) {
+    int size = 2 * ball_radius + 1;
+    SpriteInfo& ball = sprites[GFX_SPRITE_BALL];
+    ball = {GFX_ATLAS, size, size, true};
+    uint32_t* p = (uint32_t*)ball.address;
+    for (int dy = -ball_radius; dy <= ball_radius; dy++) {
+        int w = gfxCircleHalfWidth(ball_radius, dy);
+        for (int dx = -ball_radius; dx <= ball_radius; dx++) {
+            *p++ = (dx >= -w && dx <= w) ? LCD_COLOR_WHITE : 0x00000000;
+        }
+    }
+
+    SpriteInfo& paddle = sprites[GFX_SPRITE_PADDLE];
+    paddle = {GFX_ATLAS + GFX_SPRITE_MAX_BYTES, paddle_width, paddle_height, false};
+    gfx_pixel_t* q = (gfx_pixel_t*)paddle.address;
+    for (int i = 0; i < paddle_width * paddle_height; i++) { *q++ = gfxColor(LCD_COLOR_WHITE); }
+
+#if GFX_PIXEL_FORMAT == GFX_FORMAT_L8
+    int screen = BSP_LCD_GetXSize() * BSP_LCD_GetYSize();
+    for (int i = 0; i < GFX_PALETTE_SIZE; i++) { memset((void*)(GFX_SWATCHES + i * screen), i, screen); }
+#endif
+}
+
+// Draws a sprite with its top-left corner at x, y, limited to the clip rect
+// [clip_x0, clip_x1) x [clip_y0, clip_y1)
+void gfxDrawSprite(GfxSprite sprite, int x, int y, int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    const SpriteInfo& s = sprites[sprite];
+    int pitch = BSP_LCD_GetXSize();
+    int x0 = max(max(x, clip_x0), 0);
+    int y0 = max(max(y, clip_y0), 0);
+    int x1 = min(min(x + s.width, clip_x1), pitch);
+    int y1 = min(min(y + s.height, clip_y1), (int)BSP_LCD_GetYSize());
+    if (x0 >= x1 || y0 >= y1) { return; }
+    int w = x1 - x0;
+    int h = y1 - y0;
+    stats.countDraw(w * h, 1);
+    uint32_t src = s.address + (s.blend ? 4 : GFX_BYTES_PER_PIXEL) * ((y0 - y) * s.width + (x0 - x));
+    uint32_t dst = display.drawAddress() + GFX_BYTES_PER_PIXEL * (y0 * pitch + x0);
+    if (s.blend) {
+        dma2d.blend(src, s.width - w, dst, pitch - w, w, h);
+    } else {
+        dma2d.copy(src, s.width - w, dst, pitch - w, w, h);
+    }
+}
+
+// Frame time of drawing n balls and both paddles three ways: the BSP's
+// FillCircle/FillRect, the span rasteriser, and sprite blits. The screen is
+// cleared outside the timed part. The BSP only draws ARGB8888, so its column
+// reads zero in the other formats.
+void gfxBenchmark() {
+    const int frames = 100;
+    const int radius = 3;
+    const int paddle_width = 36;
+    const int paddle_height = 5;
+    gfxBuildSprites(radius, paddle_width, paddle_height);
+    int width = BSP_LCD_GetXSize();
+    int height = BSP_LCD_GetYSize();
+    printf("[Gfx] us/frame      bsp     span   sprite\n");
+    for (int n : {8, 64}) {
+        float us[3] = {0, 0, 0};
+        for (int path = GFX_PIXEL_FORMAT == GFX_FORMAT_ARGB8888 ? 0 : 1; path < 3; path++) {
+            gameSeed(n);
+            Timer timer;
+            for (int f = 0; f < frames; f++) {
+                gfxFillRect(0, 0, width, height, LCD_COLOR_BLACK);
+                gfxSync();
+                timer.start();
+                for (int i = 0; i < n; i++) {
+                    int x = radius + gameRandom() % (width - 2 * radius);
+                    int y = radius + gameRandom() % (height - 2 * radius);
+                    if (path == 0) {
+                        LCD.SetTextColor(LCD_COLOR_WHITE);
+                        LCD.FillCircle(x, y, radius);
+                    } else if (path == 1) {
+                        gfxFillCircle(x, y, radius, LCD_COLOR_WHITE);
+                    } else {
+                        gfxDrawSprite(GFX_SPRITE_BALL, x - radius, y - radius, 0, 0, width, height);
+                    }
+                }
+                for (int p = 0; p < 2; p++) {
+                    int y = p ? height - 10 : 25;
+                    if (path == 0) {
+                        LCD.FillRect(102, y, paddle_width, paddle_height);
+                    } else if (path == 1) {
+                        gfxFillRect(102, y, paddle_width, paddle_height, LCD_COLOR_WHITE);
+                    } else {
+                        gfxDrawSprite(GFX_SPRITE_PADDLE, 102, y, 0, 0, width, height);
+                    }
+                }
+                gfxSync();
+                timer.stop();
+            }
+            us[path] = (float)timer.elapsed_time().count() / frames;
+        }
+        printf("[Gfx] %2d balls  %8.1f %8.1f %8.1f\n", n, us[0], us[1], us[2]);
+    }
+    gfxFillRect(0, 0, width, height, LCD_COLOR_BLACK); // the HUD relies on a black strip under it
+}
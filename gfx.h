@@ -0,0 +1,129 @@
+#ifndef GFX_H
+#define GFX_H
+
+#include <stdint.h>
+#include "LCD_DISCO_F429ZI.h"
+
+#define GFX_FORMAT_ARGB8888 0 // what the BSP draws in
+#define GFX_FORMAT_RGB565 1    // half the bytes, full DMA2D support
+#define GFX_FORMAT_L8 2        // a quarter of the bytes through a CLUT; DMA2D can copy but not fill or blend L8
+#ifndef GFX_PIXEL_FORMAT
+#define GFX_PIXEL_FORMAT GFX_FORMAT_RGB565 // frame buffer format; the game only draws black and white
+#endif
+
+#if GFX_PIXEL_FORMAT == GFX_FORMAT_ARGB8888
+#define GFX_BYTES_PER_PIXEL 4
+#define GFX_COLOR_MODE 0 // LTDC and DMA2D share these pixel format codes
+typedef uint32_t gfx_pixel_t;
+#elif GFX_PIXEL_FORMAT == GFX_FORMAT_RGB565
+#define GFX_BYTES_PER_PIXEL 2
+#define GFX_COLOR_MODE 2
+typedef uint16_t gfx_pixel_t;
+#elif GFX_PIXEL_FORMAT == GFX_FORMAT_L8
+#define GFX_BYTES_PER_PIXEL 1
+#define GFX_COLOR_MODE 5
+typedef uint8_t gfx_pixel_t;
+#else
+#error "unknown GFX_PIXEL_FORMAT"
+#endif
+
+#define GFX_SPAN_TABLE_RADIUS 8 // circles up to this radius use the precomputed spans
+#define GFX_CPU_CIRCLE_RADIUS 8 // circles up to this radius are written by the CPU, larger ones by DMA2D
+#ifndef GFX_USE_SPRITES
+#define GFX_USE_SPRITES (GFX_PIXEL_FORMAT != GFX_FORMAT_L8) // 1 to blit balls and paddles from the sprite atlas, 0 to rasterise them
+#endif
+#if GFX_USE_SPRITES && GFX_PIXEL_FORMAT == GFX_FORMAT_L8
+#error "the ball sprite is alpha blended, which DMA2D cannot write as L8"
+#endif
+#ifndef GFX_BENCHMARK
+#define GFX_BENCHMARK 0 // 1 to time the draw paths at boot and print the results over serial
+#endif
+#define GFX_SPRITE_MAX_BYTES 0x4000 // atlas space per sprite
+#define GFX_GLYPH_CACHE_SLOTS 64 // glyph tiles kept expanded, least recently used goes first
+#define GFX_GLYPH_SLOT_BYTES (17 * 24 * GFX_BYTES_PER_PIXEL) // one tile of the largest font, Font24
+
+// L8 colour lookup table, loaded into the LTDC by Display::init()
+constexpr uint32_t GFX_PALETTE[] = {LCD_COLOR_BLACK, LCD_COLOR_WHITE};
+constexpr int GFX_PALETTE_SIZE = sizeof(GFX_PALETTE) / sizeof(GFX_PALETTE[0]);
+
+// Frame buffer pixel value for an ARGB8888 colour. L8 picks the palette entry
+// nearest in RGB.
+constexpr gfx_pixel_t gfxColor(uint32_t argb) {
+#if GFX_PIXEL_FORMAT == GFX_FORMAT_ARGB8888
+    return argb;
+#elif GFX_PIXEL_FORMAT == GFX_FORMAT_RGB565
+    return ((argb >> 8) & 0xF800) | ((argb >> 5) & 0x07E0) | ((argb >> 3) & 0x001F);
+#else
+    int best = 0;
+    uint32_t best_distance = 0xFFFFFFFF;
+    for (int i = 0; i < GFX_PALETTE_SIZE; i++) {
+        uint32_t distance = 0;
+        for (int shift = 0; shift < 24; shift += 8) {
+            int d = (int)((argb >> shift) & 0xFF) - (int)((GFX_PALETTE[i] >> shift) & 0xFF);
+            distance += d * d;
+        }
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = i;
+        }
+    }
+    return best;
+#endif
+}
+
+typedef enum {
+    GFX_SPRITE_BALL = 0,   // white disc on transparent, blended
+    GFX_SPRITE_PADDLE = 1, // solid white, copied
+    GFX_NUM_SPRITES = 2,
+} GfxSprite;
+
+// Overlay pages, composited over the game on their own LTDC layer. Black is
+// transparent there, so the game shows through it.
+typedef enum {
+    GFX_OVERLAY_HUD = 0,   // scoreboard strip during a match
+    GFX_OVERLAY_MENU = 1,  // drawn once at boot
+    GFX_OVERLAY_PAUSE = 2, // drawn once at boot, over the frozen game
+    GFX_NUM_OVERLAYS = 3,
+} GfxOverlay;
+
+// Circle spans: row dy of a radius r circle covers x - w .. x + w with
+// w = gfxCircleHalfWidth(r, dy), the widest w with w*w + dy*dy <= r*r + r.
+// The + r rounds the edge to the nearest pixel instead of flattening the
+// top and bottom rows.
+constexpr int gfxCircleHalfWidthSlow(int r, int dy) {
+    int w = 0;
+    while ((w + 1) * (w + 1) + dy * dy <= r * r + r) { w++; }
+    return w;
+}
+
+struct GfxSpanTable {
+    uint8_t halfWidth[GFX_SPAN_TABLE_RADIUS + 1][GFX_SPAN_TABLE_RADIUS + 1];
+    constexpr GfxSpanTable() : halfWidth() {
+        for (int r = 0; r <= GFX_SPAN_TABLE_RADIUS; r++) {
+            for (int dy = 0; dy <= r; dy++) { halfWidth[r][dy] = gfxCircleHalfWidthSlow(r, dy); }
+        }
+    }
+};
+
+constexpr GfxSpanTable GFX_SPANS;
+
+inline int gfxCircleHalfWidth(int r, int dy) {
+    if (dy < 0) { dy = -dy; }
+    return r <= GFX_SPAN_TABLE_RADIUS ? GFX_SPANS.halfWidth[r][dy] : gfxCircleHalfWidthSlow(r, dy);
+}
+
+// Drawing primitives for the game renderer, in screen pixels of the buffer
+// currently being drawn. Colours are ARGB8888 and converted with gfxColor(). On the board they are queued to DMA2D (gfx.cpp), so
+// call gfxSync() before touching the frame with the CPU or the BSP and before
+// presenting it. The host build has its own (host/host_gfx.cpp).
+void gfxFillRect(int x, int y, int width, int height, uint32_t color);
+void gfxFillCircle(int x, int y, int radius, uint32_t color);
+void gfxSync();
+void gfxBuildSprites(int ball_radius, int paddle_width, int paddle_height);
+void gfxDrawSprite(GfxSprite sprite, int x, int y, int clip_x0, int clip_y0, int clip_x1, int clip_y1);
+void gfxBeginOverlay(GfxOverlay overlay);
+void gfxEndOverlay();
+void gfxDrawString(int x, int y, const char* text, sFONT* font, uint32_t color, uint32_t back_color, Text_AlignModeTypdef mode);
+void gfxBenchmark();
+
+#endif // GFX_H
@@ -0,0 +1,36 @@
+#include "functions.h"
+#include "host_hal.h"
+#include <chrono>
+
+// Sweeps the number of live balls from 1 to MAX_NUM_OF_BALLS and reports the
+// cost of one Board::moveBalls() tick at each size.
+// usage: bench_ball_pool [ticks_per_size] [seed] [collisions]
+
+int main(int argc, char **argv) {
+    long ticks = argc > 1 ? atol(argv[1]) : 200000;
+    uint32_t seed = argc > 2 ? strtoul(argv[2], nullptr, 0) : 1;
+    bool collisions = argc > 3 ? atoi(argv[3]) != 0 : false;
+
+    printf("physics=%s pool=%d ticks/size=%ld seed=%u collisions=%s\n", FIXED_POINT_PHYSICS ? "Q16.16" : "float", MAX_NUM_OF_BALLS, ticks, seed, collisions ? "on" : "off");
+    printf("%8s %12s %14s\n", "balls", "ns/tick", "ns/ball-tick");
+    for (int num_balls = 1; num_balls <= MAX_NUM_OF_BALLS; num_balls *= 2) {
+        hostSeedRng(seed);
+        Board board(0, 20, 240, 320);
+        board.setAI1Enabled(true);
+        board.setAI2Enabled(true);
+        board.setWireless(false);
+        board.setBallCollisions(collisions);
+
+        long ball_ticks = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (long t = 0; t < ticks; t++) {
+            while (board.getNumBalls() < num_balls) { board.spawnBall(); }
+            board.moveBalls();
+            ball_ticks += board.getNumBalls();
+        }
+        auto end = std::chrono::steady_clock::now();
+        double secs = std::chrono::duration<double>(end - start).count();
+        printf("%8d %12.1f %14.1f\n", num_balls, secs * 1e9 / ticks, secs * 1e9 / ball_ticks);
+    }
+    return 0;
+}
@@ -0,0 +1,36 @@
+#include "functions.h"
+#include "host_hal.h"
+#include <chrono>
+
+// Runs Board::moveBalls() headless and reports tick throughput.
+// usage: bench_physics [balls] [ticks] [seed]
+
+int main(int argc, char **argv) {
+    int num_balls = argc > 1 ? atoi(argv[1]) : 1;
+    long ticks = argc > 2 ? atol(argv[2]) : 5000000;
+    uint32_t seed = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1;
+
+    hostSeedRng(seed);
+    Board board(0, 20, 240, 320);
+    board.setAI1Enabled(true);
+    board.setAI2Enabled(true);
+    board.setWireless(false);
+
+    long ball_ticks = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (long t = 0; t < ticks; t++) {
+        while (board.getNumBalls() < num_balls) { board.spawnBall(); }
+        board.moveBalls();
+        ball_ticks += board.getNumBalls();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+
+    printf("physics=%s balls=%d ticks=%ld seed=%u\n", FIXED_POINT_PHYSICS ? "Q16.16" : "float", num_balls, ticks, seed);
+    printf("elapsed      : %.3f s\n", secs);
+    printf("ticks/s      : %.0f\n", ticks / secs);
+    printf("ns/tick      : %.1f\n", secs * 1e9 / ticks);
+    printf("ns/ball-tick : %.1f\n", secs * 1e9 / ball_ticks);
+    printf("score        : %d - %d\n", board.getScore1(), board.getScore2());
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "functions.h"
+#include "host_hal.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// Replays recorded matches and encodes the board state the master would send
+// at 50 fps with v2 (keyframes and deltas) and v3 (velocities, dead reckoning)
+// of rf_protocol.h, each at one send per 1, 4 and 8 frames. v2 at a lower
+// rate just skips frames; v3 also sends whenever a ball turns. The slave side
+// decodes what arrives and shows it through RfBallTracker, with the master's
+// tick known exactly. Every decoded frame is checked against what was sent.
+// "error" is how far the shown balls are from the master's, "jerk" how much
+// more a shown ball moves in one frame than the real one did; both in px.
+// --loss drops that percentage of frames at random; with ACK payloads the
+// master sees the failure and resends in full, as in main.cpp; --no-ack
+// leaves the slave to wait for the next keyframe or refresh instead.
+// Airtime is at 1 Mbps with a 5-byte address and 2-byte CRC.
+// usage: bench_protocol <log.bin>... [--loss <percent>] [--no-ack] [--seed <n>]
+
+#define PROTOCOL_FPS 50
+
+struct BenchConfig {
+    int version;
+    int interval;
+};
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { return false; }
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) { out.insert(out.end(), chunk, chunk + n); }
+    fclose(f);
+    return true;
+}
+
+// What Board::transmitBoardState builds from the snapshot
+static RfBoardState boardState(const BoardSnapshot& snap) {
+    RfBoardState state = {};
+    state.state = STATE_GAME;
+    state.num_balls = min(snap.num_balls, RF_MAX_BALLS);
+    state.tick = snap.step & 0xFFFF;
+    for (int i = 0; i < state.num_balls; ++i) {
+        state.ball_x[i] = (int)snap.balls[i].x & 0xFF;
+        state.ball_y[i] = (int)snap.balls[i].y & 0xFFFF;
+        state.ball_vx[i] = lroundf(snap.balls[i].x_speed * PHYSICS_STEP_SCALE * RF_VELOCITY_SCALE);
+        state.ball_vy[i] = lroundf(snap.balls[i].y_speed * PHYSICS_STEP_SCALE * RF_VELOCITY_SCALE);
+    }
+    state.paddle_x[0] = snap.paddle_x[0] & 0xFF;
+    state.paddle_x[1] = snap.paddle_x[1] & 0xFF;
+    state.score[0] = min(snap.score1, RF_MAX_SCORE);
+    state.score[1] = min(snap.score2, RF_MAX_SCORE);
+    return state;
+}
+
+// Whether the slave now holds what this frame said
+static bool decodedMatches(const RfBoardState& got, const RfBoardState& sent, int version) {
+    if (version < 3) { return got == sent; }
+    if (got.num_balls != sent.num_balls || got.paddle_x[0] != sent.paddle_x[0] || got.paddle_x[1] != sent.paddle_x[1] ||
+        got.score[0] != sent.score[0] || got.score[1] != sent.score[1]) {
+        return false;
+    }
+    for (int i = 0; i < got.num_balls; i++) {
+        if (!(got.ball_known & (1 << i)) || got.ball_tick[i] != sent.tick) { continue; }
+        if (got.ball_x[i] != sent.ball_x[i] || got.ball_y[i] != sent.ball_y[i] || got.ball_vx[i] != sent.ball_vx[i] ||
+            got.ball_vy[i] != sent.ball_vy[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static double airtimeUs(double bytes) { return 8 * (1 + 5 + bytes + 2) + 9; }
+
+static float percentile(std::vector<float>& values, int p) {
+    if (values.empty()) { return 0; }
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, values.size() * p / 100)];
+}
+
+static int run(const std::vector<uint8_t>& log, BenchConfig config, int loss, bool ack, uint32_t seed) {
+    ReplayReader reader(log.data(), log.size());
+    Board board(0, 20, 240, 320);
+    board.setAI1Enabled(reader.flags & REPLAY_FLAG_AI1);
+    board.setAI2Enabled(reader.flags & REPLAY_FLAG_AI2);
+    board.setWireless(false);
+    board.setBallCollisions(reader.flags & REPLAY_FLAG_COLLISIONS);
+    board.startMatch(reader.seed);
+
+    RfFrameEncoder encoder(config.version);
+    encoder.setSendInterval(config.interval);
+    RfFrameDecoder decoder;
+    RfBallTracker tracker;
+    int radius = board.getBallRadius();
+    tracker.setBounds(board.getMinWidth() + radius, board.getMaxWidth() - radius, board.getMinHeight() + radius,
+                      board.getMaxHeight() - radius);
+
+    int frames = 0;
+    int sent = 0;
+    uint64_t bytes = 0;
+    int dropped = 0;
+    int stale = 0;
+    int mismatched = 0;
+    std::vector<float> errors;
+    std::vector<float> jerks;
+    float lastShownX[RF_MAX_BALLS], lastShownY[RF_MAX_BALLS], lastTrueX[RF_MAX_BALLS], lastTrueY[RF_MAX_BALLS];
+    uint8_t lastShown = 0;
+    int lastCount = -1;
+    uint32_t loss_rng = seed;
+    auto frame = [&]() {
+        board.publishSnapshot(0);
+        const BoardSnapshot& snap = board.acquireSnapshot();
+        RfBoardState state = boardState(snap);
+        uint8_t message[RF_FRAME_SIZE] = {0};
+        size_t length = 0;
+        if (config.version >= 3 || frames % config.interval == 0) { length = encoder.encode(state, message); }
+        frames++;
+        if (length > 0) {
+            encoder.commit();
+            sent++;
+            bytes += length;
+            loss_rng ^= loss_rng << 13;
+            loss_rng ^= loss_rng >> 17;
+            loss_rng ^= loss_rng << 5;
+            if ((int)(loss_rng % 100) < loss) {
+                dropped++;
+                if (ack) { encoder.reset(); }
+            } else if (!decoder.decode(message, length)) {
+                stale++;
+            } else if (!decodedMatches(decoder.getState(), state, config.version)) {
+                mismatched++;
+            }
+        }
+
+        // the slave's view against the master's
+        const RfBoardState& slave = decoder.getState();
+        tracker.update(slave, state.tick);
+        uint8_t shown = 0;
+        for (int i = 0; i < state.num_balls && slave.num_balls == state.num_balls; i++) {
+            if (!tracker.isShown(i)) { continue; }
+            float x = tracker.getX(i);
+            float y = tracker.getY(i);
+            errors.push_back(hypotf(x - snap.balls[i].x, y - snap.balls[i].y));
+            if ((lastShown & (1 << i)) && lastCount == state.num_balls) {
+                jerks.push_back(hypotf((x - lastShownX[i]) - (snap.balls[i].x - lastTrueX[i]),
+                                       (y - lastShownY[i]) - (snap.balls[i].y - lastTrueY[i])));
+            }
+            lastShownX[i] = x;
+            lastShownY[i] = y;
+            lastTrueX[i] = snap.balls[i].x;
+            lastTrueY[i] = snap.balls[i].y;
+            shown |= 1 << i;
+        }
+        lastShown = shown;
+        lastCount = state.num_balls;
+    };
+
+    uint32_t record_step;
+    InputType type;
+    int arg, arg2;
+    while (reader.next(record_step, type, arg, arg2)) {
+        while (board.getStepCount() < record_step) {
+            board.step();
+            if (board.getStepCount() % (PHYSICS_HZ / PROTOCOL_FPS) == 0) { frame(); }
+        }
+        if (type == REPLAY_END) { break; }
+        board.queueInput(type, arg);
+    }
+
+    double seconds = (double)frames / PROTOCOL_FPS;
+    double per_frame = sent ? (double)bytes / sent : 0;
+    printf("  v%d  1/%-3d %8.1f %9.2f %8.0f %8.0f %9.2f %6.2f %6.1f %9.2f %6.1f %8d %6d %5d\n", config.version, config.interval,
+           sent / seconds, per_frame, bytes / seconds, sent * airtimeUs(per_frame) / seconds / 1000, percentile(errors, 50),
+           percentile(errors, 99), percentile(errors, 100), percentile(jerks, 99), percentile(jerks, 100), dropped, stale,
+           mismatched);
+    return mismatched ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    std::vector<const char*> paths;
+    int loss = 0;
+    bool ack = true;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) { loss = atoi(argv[++i]); }
+        else if (strcmp(argv[i], "--no-ack") == 0) { ack = false; }
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) { seed = strtoul(argv[++i], nullptr, 0); }
+        else { paths.push_back(argv[i]); }
+    }
+    if (paths.empty() || loss < 0 || loss > 100 || seed == 0) {
+        fprintf(stderr, "usage: %s <log.bin>... [--loss <percent>] [--no-ack] [--seed <n>]\n", argv[0]);
+        return 2;
+    }
+
+    BenchConfig configs[] = {{2, 1}, {2, 4}, {2, 8}, {3, 1}, {3, 4}, {3, 8}};
+    int result = 0;
+    for (const char* path : paths) {
+        std::vector<uint8_t> log;
+        if (!readFile(path, log)) {
+            fprintf(stderr, "%s: cannot read\n", path);
+            result = 1;
+            continue;
+        }
+        ReplayReader reader(log.data(), log.size());
+        if (!reader.valid()) {
+            fprintf(stderr, "%s: not a replay log\n", path);
+            result = 1;
+            continue;
+        }
+        printf("%s: fps=%d loss=%d%%%s\n", path, PROTOCOL_FPS, loss, ack ? "" : " no-ack");
+        printf("  %-9s %8s %9s %8s %8s %9s %6s %6s %9s %6s %8s %6s %5s\n", "sends", "frames/s", "bytes/frm", "bytes/s",
+               "air ms/s", "error p50", "p99", "max", "jerk p99", "max", "dropped", "stale", "bad");
+        for (BenchConfig config : configs) { result |= run(log, config, loss, ack, seed); }
+    }
+    return result;
+}
@@ -0,0 +1,93 @@
+#include "mbed.h"
+#include "nRF24L01P.h"
+#include "host_radio.h"
+#include <cstdlib>
+
+// Runs the real nRF24L01P driver against the simulated radio and compares
+// sending a stream of packets with the blocking write (a mode flip and a
+// settle per packet) against the pipelined enqueue/poll queue, polled and
+// IRQ-driven. The radio starts in RX with CE high, as the game leaves it.
+// Times are virtual: SPI at the driver's 2 MHz, the datasheet's settling and
+// airtime. "cpu" is the part spent in SPI and wait_us rather than idle.
+// usage: bench_rf [packets] [payload bytes]
+
+#define BENCH_RF_CSN PE_11
+#define BENCH_RF_CE PE_9
+#define BENCH_RF_IRQ PE_4
+
+enum BenchPath { PATH_WRITE, PATH_POLL, PATH_IRQ };
+
+static void fillPayload(char* payload, int count, int seq) {
+    for (int i = 0; i < count; i++) { payload[i] = (char)(seq * 7 + i); }
+    memcpy(payload, &seq, count < 4 ? count : 4);
+}
+
+static bool run(const char* name, BenchPath path, int rate, int packets, int count) {
+    nRF24L01P radio(PE_14, PE_13, PE_12, BENCH_RF_CSN, BENCH_RF_CE, path == PATH_IRQ ? BENCH_RF_IRQ : NC);
+    EventQueue queue;
+    radio.setAirDataRate(rate);
+    radio.setTransferSize(count);
+    radio.powerUp();
+    radio.setReceiveMode();
+    radio.enable();
+    if (path == PATH_IRQ) {
+        radio.enableInterrupts(&queue);
+        queue.dispatch_once();
+    }
+    host_radio.received.clear();
+
+    uint64_t start = hostRadioNowNs();
+    uint64_t busy = hostRadioBusyNs();
+    uint64_t limit = start + (uint64_t)packets * 10000000; // 10 ms a packet means it is stuck
+    char payload[32];
+    int next = 0;
+    if (path == PATH_WRITE) {
+        for (; next < packets; next++) {
+            fillPayload(payload, count, next);
+            radio.write(NRF24L01P_PIPE_P0, payload, count);
+        }
+    } else {
+        fillPayload(payload, count, next);
+        while (hostRadioNowNs() < limit) {
+            while (next < packets && radio.enqueue(NRF24L01P_PIPE_P0, payload, count)) {
+                fillPayload(payload, count, ++next);
+            }
+            if (path == PATH_IRQ) { queue.dispatch_once(); }
+            int pending = radio.poll();
+            if (next == packets && pending == 0) { break; }
+            if (path == PATH_IRQ && !hostRadioWaitEvent()) { break; }
+        }
+    }
+    double us = (hostRadioNowNs() - start) / 1000.0;
+    double cpu_us = (hostRadioBusyNs() - busy) / 1000.0;
+    host_radio.irqCallback = nullptr;
+
+    bool ok = (int)host_radio.received.size() == packets;
+    for (int i = 0; ok && i < packets; i++) {
+        fillPayload(payload, count, i);
+        ok = host_radio.received[i] == RadioPayload(payload, payload + count);
+    }
+    printf("%5d kbps  %-14s %9.0f %9.1f %11.1f  %s\n", rate, name, packets * 1e6 / us, us / packets, cpu_us / packets,
+           ok ? "ok" : "LOST OR REORDERED");
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    int packets = argc > 1 ? atoi(argv[1]) : 1000;
+    int count = argc > 2 ? atoi(argv[2]) : 32;
+    if (packets <= 0 || count < 1 || count > 32) {
+        fprintf(stderr, "usage: %s [packets] [payload bytes 1..32]\n", argv[0]);
+        return 2;
+    }
+
+    printf("packets=%d payload=%d bytes queue=%d\n", packets, count, NRF24L01P_TX_QUEUE_DEPTH);
+    printf("%10s  %-14s %9s %9s %11s\n", "rate", "path", "pkt/s", "us/pkt", "cpu us/pkt");
+    bool ok = true;
+    int rates[] = {NRF24L01P_DATARATE_250_KBPS, NRF24L01P_DATARATE_1_MBPS, NRF24L01P_DATARATE_2_MBPS};
+    for (int rate : rates) {
+        ok &= run("write", PATH_WRITE, rate, packets, count);
+        ok &= run("enqueue/poll", PATH_POLL, rate, packets, count);
+        ok &= run("enqueue (IRQ)", PATH_IRQ, rate, packets, count);
+    }
+    return ok ? 0 : 1;
+}
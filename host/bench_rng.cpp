@@ -0,0 +1,60 @@
+#include "functions.h"
+#include "host_hal.h"
+#include <chrono>
+
+// Compares the cost per sample of the old randBetween (one rngGetRandomNumber()
+// call plus a modulo and a divide per float) against the xoshiro128** game RNG,
+// scalar and batched. On the board the old path also busy-waits on RNG_SR_DRDY,
+// which the host stand-in cannot show.
+// usage: bench_rng [samples] [seed]
+
+static volatile float sink;
+
+// randBetween as it was before the game RNG
+static float legacyRandBetween(float min, float max) {
+    return ((float)(rngGetRandomNumber() % 1000000))/1000000.0 * (max-min)+min;
+}
+
+template <typename F>
+static void run(const char* name, long samples, F sample) {
+    auto start = std::chrono::steady_clock::now();
+    float acc = 0;
+    long done = 0;
+    while (done < samples) { done += sample(acc); }
+    auto end = std::chrono::steady_clock::now();
+    sink = acc;
+    double secs = std::chrono::duration<double>(end - start).count();
+    printf("%-20s %10.2f\n", name, secs * 1e9 / done);
+}
+
+int main(int argc, char **argv) {
+    long samples = argc > 1 ? atol(argv[1]) : 50000000;
+    uint32_t seed = argc > 2 ? strtoul(argv[2], nullptr, 0) : 1;
+
+    hostSeedRng(seed);
+    gameSeed(seed);
+    printf("samples=%ld seed=%u\n", samples, seed);
+    printf("%-20s %10s\n", "path", "ns/sample");
+
+    run("legacy", samples, [](float& acc) { acc += legacyRandBetween(-1.5, 1.5); return 1; });
+    run("randBetween", samples, [](float& acc) { acc += randBetween(-1.5, 1.5); return 1; });
+    run("randBetween x4", samples, [](float& acc) {
+        float out[4];
+        randBetween(-1.5, 1.5, out, 4);
+        acc += out[0] + out[1] + out[2] + out[3];
+        return 4;
+    });
+    run("randBetween x64", samples, [](float& acc) {
+        float out[64];
+        randBetween(-1.5, 1.5, out, 64);
+        for (int i = 0; i < 64; i++) { acc += out[i]; }
+        return 64;
+    });
+    run("randPhysBetween x2", samples, [](float& acc) {
+        phys_t out[2];
+        randPhysBetween(1, 1.05, out, 2);
+        acc += (float)out[0] + (float)out[1];
+        return 2;
+    });
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "gfx.h"
+#include "LCD_DISCO_F429ZI.h"
+#include "stats.h"
+
+// Host stand-ins for the DMA2D-backed primitives. They draw into the stub
+// LCD's software frame with the same geometry as gfx.cpp, and write the same
+// pixels a DMA2D transfer would, so host frames, pixel-write counts and stats
+// match the board (in ARGB8888). Overlay pages land in the one frame, which is
+// what the board shows too: the game never draws under the HUD strip.
+
+extern LCD_DISCO_F429ZI LCD;
+
+static int sprite_ball_radius = 3;
+static int sprite_paddle_width = 36;
+static int sprite_paddle_height = 5;
+
+void gfxFillRect(int x, int y, int width, int height, uint32_t color) {
+    if (width <= 0 || height <= 0) { return; }
+    stats.countDraw(width * height, 1);
+    LCD.SetTextColor(color);
+    LCD.FillRect(x, y, width, height);
+}
+
+void gfxFillCircle(int x, int y, int radius, uint32_t color) {
+    int pitch = LCD.GetXSize();
+    int y0 = max(y - radius, 0);
+    int y1 = min(y + radius, (int)LCD.GetYSize() - 1);
+    LCD.SetTextColor(color);
+    int pixels = 0;
+    for (int row = y0; row <= y1; row++) {
+        int w = gfxCircleHalfWidth(radius, row - y);
+        int x0 = max(x - w, 0);
+        int x1 = min(x + w, pitch - 1);
+        if (x0 <= x1) {
+            LCD.DrawHLine(x0, row, x1 - x0 + 1);
+            pixels += x1 - x0 + 1;
+        }
+    }
+    stats.countDraw(pixels, radius > GFX_CPU_CIRCLE_RADIUS ? y1 - y0 + 1 : 0);
+}
+
+void gfxSync() {}
+
+void gfxBuildSprites(int ball_radius, int paddle_width, int paddle_height) {
+    sprite_ball_radius = ball_radius;
+    sprite_paddle_width = paddle_width;
+    sprite_paddle_height = paddle_height;
+}
+
+// A blend rewrites every pixel of the clipped box, keeping what is under the
+// ball's transparent corners
+void gfxDrawSprite(GfxSprite sprite, int x, int y, int clip_x0, int clip_y0, int clip_x1, int clip_y1) {
+    bool ball = sprite == GFX_SPRITE_BALL;
+    int width = ball ? 2 * sprite_ball_radius + 1 : sprite_paddle_width;
+    int height = ball ? 2 * sprite_ball_radius + 1 : sprite_paddle_height;
+    int x0 = max(max(x, clip_x0), 0);
+    int y0 = max(max(y, clip_y0), 0);
+    int x1 = min(min(x + width, clip_x1), (int)LCD.GetXSize());
+    int y1 = min(min(y + height, clip_y1), (int)LCD.GetYSize());
+    if (x0 >= x1 || y0 >= y1) { return; }
+    if (!ball) {
+        gfxFillRect(x0, y0, x1 - x0, y1 - y0, LCD_COLOR_WHITE);
+        return;
+    }
+    stats.countDraw((x1 - x0) * (y1 - y0), 1);
+    for (int row = y0; row < y1; row++) {
+        int dy = row - y - sprite_ball_radius;
+        int w = gfxCircleHalfWidth(sprite_ball_radius, dy);
+        for (int col = x0; col < x1; col++) {
+            int dx = col - x - sprite_ball_radius;
+            LCD.DrawPixel(col, row, (dx >= -w && dx <= w) ? LCD_COLOR_WHITE : LCD.ReadPixel(col, row));
+        }
+    }
+}
+
+void gfxBeginOverlay(GfxOverlay overlay) {}
+
+void gfxEndOverlay() {}
+
+void gfxDrawString(int x, int y, const char* text, sFONT* font, uint32_t color, uint32_t back_color, Text_AlignModeTypdef mode) {
+    uint64_t before = LCD.getPixelWrites();
+    LCD.SetTextColor(color);
+    LCD.SetBackColor(back_color);
+    LCD.SetFont(font);
+    LCD.DisplayStringAt(x, y, (uint8_t *)text, mode);
+    uint32_t pixels = LCD.getPixelWrites() - before;
+    stats.countDraw(pixels, pixels / (font->Width * font->Height));
+}
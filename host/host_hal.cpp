@@ -0,0 +1,45 @@
+#include "functions.h"
+#include "host_hal.h"
+#include "stats.h"
+
+// DEVICES --------------------------------
+
+LCD_DISCO_F429ZI LCD;
+nRF24L01P master(PE_14, PE_13, PE_12, PE_11, PE_9, NC);
+nRF24L01P slave(PE_14, PE_13, PE_12, PE_11, PE_9, NC);
+Ticker goal_ticker;
+
+// GLOBAL VARS ----------------------------
+
+StateType curr_state = STATE_GAME;
+int goal_ticker_counter = 0;
+static uint32_t rng_state = 0x2545F491;
+
+// ISRs -----------------------------------
+
+void GoalTickerCallback() {}
+
+// HELPER FUNCTIONS ------------------------
+
+void hostSeedRng(uint32_t seed) {
+    rng_state = seed ? seed : 0x2545F491;
+}
+
+void rngInit() {}
+
+uint32_t rngGetRandomNumber() {
+    // xorshift32 in place of the RNG_DR register
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Nanoseconds stand in for DWT cycles, so the stats read in real time
+void statsInitClock() {}
+
+uint32_t statsCycles() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t statsCyclesPerUs() { return 1000; }
@@ -0,0 +1,9 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include <cstdint>
+
+// Reseeds the software stand-in for the STM32 RNG so runs are reproducible.
+void hostSeedRng(uint32_t seed);
+
+#endif // HOST_HAL_H
@@ -0,0 +1,213 @@
+#include "LCD_DISCO_F429ZI.h"
+#include <vector>
+
+// Software frame for the host LCD stand-in. Every primitive follows the BSP
+// (stm32f429i_discovery_lcd.c): pixels are addressed as y * width + x with no
+// clipping, so an x past the edge wraps onto the next row just like on the
+// board; writes that would land outside the frame are counted but dropped.
+
+// HELPER FUNCTIONS ------------------------
+
+static uint32_t crc_table[256];
+
+static uint32_t crc32(const uint8_t* data, size_t n, uint32_t crc = 0) {
+    if (!crc_table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) { c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1; }
+            crc_table[i] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) { crc = crc_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8); }
+    return ~crc;
+}
+
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t v) {
+    for (int shift = 24; shift >= 0; shift -= 8) { out.push_back((v >> shift) & 0xFF); }
+}
+
+static void writeChunk(FILE* f, const char* type, const std::vector<uint8_t>& data) {
+    std::vector<uint8_t> chunk;
+    putBigEndian(chunk, data.size());
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    fwrite(chunk.data(), 1, chunk.size(), f);
+}
+
+// LCD METHODS
+
+LCD_DISCO_F429ZI::LCD_DISCO_F429ZI() : textColor(LCD_COLOR_BLACK), backColor(LCD_COLOR_WHITE), font(&Font16) {
+    Clear(LCD_COLOR_WHITE);
+    pixelWrites = 0;
+}
+
+void LCD_DISCO_F429ZI::Clear(uint32_t Color) {
+    for (int i = 0; i < HOST_LCD_WIDTH * HOST_LCD_HEIGHT; i++) { frame[i] = Color; }
+    pixelWrites += HOST_LCD_WIDTH * HOST_LCD_HEIGHT;
+}
+
+void LCD_DISCO_F429ZI::DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code) {
+    uint32_t i = (uint32_t)Ypos * HOST_LCD_WIDTH + Xpos;
+    if (i < HOST_LCD_WIDTH * HOST_LCD_HEIGHT) { frame[i] = RGB_Code; }
+    pixelWrites++;
+}
+
+uint32_t LCD_DISCO_F429ZI::ReadPixel(uint16_t Xpos, uint16_t Ypos) const {
+    uint32_t i = (uint32_t)Ypos * HOST_LCD_WIDTH + Xpos;
+    return i < HOST_LCD_WIDTH * HOST_LCD_HEIGHT ? frame[i] : 0;
+}
+
+void LCD_DISCO_F429ZI::DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length) {
+    for (int i = 0; i < Length; i++) { DrawPixel(Xpos + i, Ypos, textColor); }
+}
+
+void LCD_DISCO_F429ZI::FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height) {
+    for (int row = 0; row < Height; row++) { DrawHLine(Xpos, Ypos + row, Width); }
+}
+
+// Bresenham outline, as BSP_LCD_DrawCircle
+void LCD_DISCO_F429ZI::DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius) {
+    int32_t d = 3 - (Radius << 1);
+    uint32_t curx = 0;
+    uint32_t cury = Radius;
+    while (curx <= cury) {
+        DrawPixel(Xpos + curx, Ypos - cury, textColor);
+        DrawPixel(Xpos - curx, Ypos - cury, textColor);
+        DrawPixel(Xpos + cury, Ypos - curx, textColor);
+        DrawPixel(Xpos - cury, Ypos - curx, textColor);
+        DrawPixel(Xpos + curx, Ypos + cury, textColor);
+        DrawPixel(Xpos - curx, Ypos + cury, textColor);
+        DrawPixel(Xpos + cury, Ypos + curx, textColor);
+        DrawPixel(Xpos - cury, Ypos + curx, textColor);
+        if (d < 0) {
+            d += (curx << 2) + 6;
+        } else {
+            d += ((curx - cury) << 2) + 10;
+            cury--;
+        }
+        curx++;
+    }
+}
+
+// Horizontal spans and then the outline on top, as BSP_LCD_FillCircle
+void LCD_DISCO_F429ZI::FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius) {
+    int32_t d = 3 - (Radius << 1);
+    uint32_t curx = 0;
+    uint32_t cury = Radius;
+    while (curx <= cury) {
+        if (cury > 0) {
+            DrawHLine(Xpos - cury, Ypos + curx, 2 * cury);
+            DrawHLine(Xpos - cury, Ypos - curx, 2 * cury);
+        }
+        if (curx > 0) {
+            DrawHLine(Xpos - curx, Ypos - cury, 2 * curx);
+            DrawHLine(Xpos - curx, Ypos + cury, 2 * curx);
+        }
+        if (d < 0) {
+            d += (curx << 2) + 6;
+        } else {
+            d += ((curx - cury) << 2) + 10;
+            cury--;
+        }
+        curx++;
+    }
+    DrawCircle(Xpos, Ypos, Radius);
+}
+
+// Every cell of the glyph is written, background included
+void LCD_DISCO_F429ZI::drawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t* c) {
+    int width = font->Width;
+    int row_bytes = (width + 7) / 8;
+    int offset = 8 * row_bytes - width;
+    for (int row = 0; row < font->Height; row++) {
+        const uint8_t* b = c + row_bytes * row;
+        uint32_t line = row_bytes == 1 ? b[0] : row_bytes == 2 ? (b[0] << 8) | b[1] : (b[0] << 16) | (b[1] << 8) | b[2];
+        for (int col = 0; col < width; col++) {
+            DrawPixel(Xpos + col, Ypos + row, (line & (1u << (width - col + offset - 1))) ? textColor : backColor);
+        }
+    }
+}
+
+void LCD_DISCO_F429ZI::DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii) {
+    drawChar(Xpos, Ypos, &font->table[(Ascii - ' ') * font->Height * ((font->Width + 7) / 8)]);
+}
+
+void LCD_DISCO_F429ZI::DisplayStringAt(uint16_t X, uint16_t Y, uint8_t *pText, Text_AlignModeTypdef mode) {
+    uint32_t size = 0;
+    while (pText[size]) { size++; }
+    uint32_t xsize = HOST_LCD_WIDTH / font->Width;
+    uint16_t refcolumn = X;
+    if (mode == CENTER_MODE) {
+        refcolumn = X + ((xsize - size) * font->Width) / 2;
+    } else if (mode == RIGHT_MODE) {
+        refcolumn = X + ((xsize - size) * font->Width);
+    }
+    for (uint32_t i = 0; *pText && ((HOST_LCD_WIDTH - i * font->Width) & 0xFFFF) >= font->Width; i++) {
+        DisplayChar(refcolumn, Y, *pText++);
+        refcolumn += font->Width;
+    }
+}
+
+// FNV-1a over the frame, for golden checks in logs and scripts
+uint32_t LCD_DISCO_F429ZI::hashFrame() const {
+    uint32_t hash = 2166136261u;
+    const uint8_t* p = (const uint8_t*)frame;
+    for (size_t i = 0; i < sizeof(frame); i++) { hash = (hash ^ p[i]) * 16777619u; }
+    return hash;
+}
+
+// Binary PPM (P6), alpha dropped
+bool LCD_DISCO_F429ZI::writePPM(const char* path) const {
+    FILE* f = fopen(path, "wb");
+    if (!f) { return false; }
+    fprintf(f, "P6\n%d %d\n255\n", HOST_LCD_WIDTH, HOST_LCD_HEIGHT);
+    for (int i = 0; i < HOST_LCD_WIDTH * HOST_LCD_HEIGHT; i++) {
+        uint8_t rgb[3] = {(uint8_t)(frame[i] >> 16), (uint8_t)(frame[i] >> 8), (uint8_t)frame[i]};
+        fwrite(rgb, 1, 3, f);
+    }
+    fclose(f);
+    return true;
+}
+
+// 8-bit RGB PNG. The image data goes in stored (uncompressed) deflate blocks,
+// so no zlib is needed; a frame is about 230 KB.
+bool LCD_DISCO_F429ZI::writePNG(const char* path) const {
+    FILE* f = fopen(path, "wb");
+    if (!f) { return false; }
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    fwrite(signature, 1, 8, f);
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, HOST_LCD_WIDTH);
+    putBigEndian(header, HOST_LCD_HEIGHT);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bits, RGB, deflate, no filter, no interlace
+    writeChunk(f, "IHDR", header);
+
+    std::vector<uint8_t> raw;
+    for (int y = 0; y < HOST_LCD_HEIGHT; y++) {
+        raw.push_back(0); // filter: none
+        for (int x = 0; x < HOST_LCD_WIDTH; x++) {
+            uint32_t c = frame[y * HOST_LCD_WIDTH + x];
+            raw.insert(raw.end(), {(uint8_t)(c >> 16), (uint8_t)(c >> 8), (uint8_t)c});
+        }
+    }
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    for (size_t pos = 0; pos < raw.size(); pos += 0xFFFF) {
+        size_t n = std::min(raw.size() - pos, (size_t)0xFFFF);
+        zlib.push_back(pos + n == raw.size() ? 1 : 0);
+        zlib.insert(zlib.end(), {(uint8_t)n, (uint8_t)(n >> 8), (uint8_t)~n, (uint8_t)(~n >> 8)});
+        zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + n);
+    }
+    uint32_t a = 1, b = 0;
+    for (uint8_t v : raw) {
+        a = (a + v) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBigEndian(zlib, (b << 16) | a);
+    writeChunk(f, "IDAT", zlib);
+    writeChunk(f, "IEND", {});
+    fclose(f);
+    return true;
+}
@@ -0,0 +1,177 @@
+#include "host_radio.h"
+
+HostRadio host_radio;
+static uint64_t now_ns = 0;
+static uint64_t busy_ns = 0;
+
+// HELPER FUNCTIONS ------------------------
+
+static void runClock(uint64_t ns) {
+    uint64_t target = now_ns + ns;
+    while (host_radio.nextEvent() <= target) {
+        now_ns = host_radio.nextEvent();
+        host_radio.runUntil(now_ns);
+    }
+    now_ns = target;
+}
+
+uint64_t hostRadioNowNs() { return now_ns; }
+uint64_t hostRadioBusyNs() { return busy_ns; }
+
+void hostRadioAdvance(uint64_t ns) {
+    busy_ns += ns;
+    runClock(ns);
+}
+
+bool hostRadioWaitEvent() {
+    uint64_t next = host_radio.nextEvent();
+    if (next == UINT64_MAX) { return false; }
+    runClock(next - now_ns);
+    return true;
+}
+
+// RADIO METHODS
+
+HostRadio::HostRadio() : regs(), txFifo(), rxFifo(), csn(1), ce(0), irqLow(false), phase(PHASE_IDLE), phaseEnd(0),
+                         command(0), byteIndex(0), irqCallback(nullptr), irqContext(nullptr) {
+    // reset values from the datasheet register map
+    regs[0x00] = 0x08; // CONFIG: EN_CRC
+    regs[0x01] = 0x3F; // EN_AA
+    regs[0x02] = 0x03; // EN_RXADDR
+    regs[0x03] = 0x03; // SETUP_AW: 5 bytes
+    regs[0x04] = 0x03; // SETUP_RETR
+    regs[0x05] = 0x02; // RF_CH
+    regs[0x06] = 0x0E; // RF_SETUP: 2 Mbps, 0 dBm
+    for (int i = 0; i < 5; i++) {
+        addresses[0][i] = 0xE7;
+        addresses[1][i] = 0xC2;
+        addresses[2][i] = 0xE7;
+    }
+}
+
+// STATUS is built on the fly; only the three IRQ flags are stored (in regs[7])
+uint8_t HostRadio::status() const {
+    int pipe = rxFifo.empty() ? 7 : 0;
+    return (regs[0x07] & 0x70) | (pipe << 1) | (txFifo.size() == 3 ? 1 : 0);
+}
+
+uint8_t HostRadio::fifoStatus() const {
+    return (txFifo.size() == 3 ? 0x20 : 0) | (txFifo.empty() ? 0x10 : 0) |
+           (rxFifo.size() == 3 ? 0x02 : 0) | (rxFifo.empty() ? 0x01 : 0);
+}
+
+uint8_t* HostRadio::registerByte(int reg, int index) {
+    if (reg == 0x0A) { return &addresses[0][index % 5]; }
+    if (reg == 0x0B) { return &addresses[1][index % 5]; }
+    if (reg == 0x10) { return &addresses[2][index % 5]; }
+    return &regs[reg];
+}
+
+// Preamble, address, payload, CRC and the 9-bit packet control field
+uint64_t HostRadio::airtimeNs(size_t bytes) const {
+    int address_width = (regs[0x03] & 0x03) + 2;
+    int crc = (regs[0x00] & 0x08) ? ((regs[0x00] & 0x04) ? 2 : 1) : 0;
+    uint64_t bits = 8 * (1 + address_width + bytes + crc) + 9;
+    int kbps = (regs[0x06] & 0x20) ? 250 : (regs[0x06] & 0x08) ? 2000 : 1000;
+    return bits * 1000000 / kbps;
+}
+
+int HostRadio::transfer(int value) {
+    if (csn) { return 0xFF; }
+    value &= 0xFF;
+    int out = 0;
+    int i = byteIndex - 1;
+    if (byteIndex == 0) {
+        command = value;
+        out = status();
+        if (command == 0xE1) { txFifo.clear(); }
+        if (command == 0xE2) { rxFifo.clear(); }
+    } else if ((command & 0xE0) == 0x00) { // R_REGISTER
+        int reg = command & 0x1F;
+        out = reg == 0x07 ? status() : reg == 0x17 ? fifoStatus() : *registerByte(reg, i);
+    } else if ((command & 0xE0) == 0x20) { // W_REGISTER
+        int reg = command & 0x1F;
+        if (reg == 0x07) {
+            regs[0x07] &= ~(value & 0x70); // write 1 to clear
+        } else {
+            *registerByte(reg, i) = value;
+        }
+    } else if (command == 0x61) { // R_RX_PAYLOAD
+        out = (!rxFifo.empty() && i < (int)rxFifo.front().size()) ? rxFifo.front()[i] : 0;
+    } else if (command == 0x60) { // R_RX_PL_WID
+        out = rxFifo.empty() ? 0 : rxFifo.front().size();
+    } else if (command == 0xA0 || command == 0xB0) { // W_TX_PAYLOAD(_NO_ACK)
+        payload.push_back(value);
+    }
+    byteIndex++;
+    return out;
+}
+
+// Commands take effect when CSN goes back up
+void HostRadio::endTransaction() {
+    if ((command == 0xA0 || command == 0xB0) && !payload.empty() && txFifo.size() < 3) { txFifo.push_back(payload); }
+    if (command == 0x61 && byteIndex > 1 && !rxFifo.empty()) { rxFifo.pop_front(); }
+    payload.clear();
+    byteIndex = 0;
+    update();
+}
+
+void HostRadio::setCsn(int value) {
+    if (value && !csn) {
+        csn = 1;
+        endTransaction();
+    }
+    csn = value;
+}
+
+void HostRadio::setCe(int value) {
+    ce = value;
+    update();
+}
+
+int HostRadio::getIrq() const { return irqLow ? 0 : 1; }
+
+// PTX state machine: a packet leaves Standby (I or II) after the 130 us
+// settling time, and with CE still high the next one follows straight away
+void HostRadio::update() {
+    bool ptx = (regs[0x00] & 0x02) && !(regs[0x00] & 0x01);
+    if (!ptx || txFifo.empty()) {
+        phase = PHASE_IDLE;
+    } else if (phase == PHASE_IDLE && ce) {
+        phase = PHASE_SETTLE;
+        phaseEnd = now_ns + 130000;
+    }
+    updateIrq();
+}
+
+void HostRadio::updateIrq() {
+    bool low = (regs[0x07] & 0x70 & ~(regs[0x00] & 0x70)) != 0;
+    bool fell = low && !irqLow;
+    irqLow = low;
+    if (fell && irqCallback) { irqCallback(irqContext); }
+}
+
+void HostRadio::finishPacket() {
+    received.push_back(txFifo.front());
+    txFifo.pop_front();
+    regs[0x07] |= 0x20; // TX_DS
+    if (ce && !txFifo.empty()) {
+        phaseEnd += airtimeNs(txFifo.front().size());
+    } else {
+        phase = PHASE_IDLE;
+    }
+    updateIrq();
+}
+
+uint64_t HostRadio::nextEvent() const { return phase == PHASE_IDLE ? UINT64_MAX : phaseEnd; }
+
+void HostRadio::runUntil(uint64_t ns) {
+    while (phase != PHASE_IDLE && phaseEnd <= ns) {
+        if (phase == PHASE_SETTLE) {
+            phase = PHASE_SEND;
+            phaseEnd += airtimeNs(txFifo.front().size());
+        } else {
+            finishPacket();
+        }
+    }
+}
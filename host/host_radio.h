@@ -0,0 +1,69 @@
+#ifndef HOST_RADIO_H
+#define HOST_RADIO_H
+
+// Simulated nRF24L01+ for running the real driver on the host: rf_stubs/mbed.h
+// routes its SPI bytes, CSN, CE and IRQ here. Time is virtual. SPI bytes,
+// wait_us, the 130 us TX settling and each packet's airtime advance the clock,
+// so throughput comes out as the board would see it. The PTX side follows
+// the datasheet state machine (Standby-I/II, back-to-back packets while CE
+// stays high and the FIFO is not empty). Sent packets loop back into a
+// receiver that just keeps them; there is no auto-ack, retransmit or loss.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <deque>
+
+typedef std::vector<uint8_t> RadioPayload;
+
+class HostRadio {
+private:
+    enum Phase { PHASE_IDLE, PHASE_SETTLE, PHASE_SEND };
+
+    uint8_t regs[0x20];
+    uint8_t addresses[3][5]; // RX_ADDR_P0, RX_ADDR_P1, TX_ADDR
+    std::deque<RadioPayload> txFifo;
+    std::deque<RadioPayload> rxFifo;
+    int csn;
+    int ce;
+    bool irqLow;
+    Phase phase;
+    uint64_t phaseEnd;
+
+    // SPI transaction in progress
+    int command;
+    int byteIndex;
+    RadioPayload payload;
+
+    uint8_t status() const;
+    uint8_t fifoStatus() const;
+    uint8_t* registerByte(int reg, int index);
+    uint64_t airtimeNs(size_t bytes) const;
+    void endTransaction();
+    void update();
+    void updateIrq();
+    void finishPacket();
+
+public:
+    std::vector<RadioPayload> received; // everything that went on air, in order
+    void (*irqCallback)(void*);         // falling edge on IRQ
+    void* irqContext;
+
+    HostRadio();
+    int transfer(int value);
+    void setCsn(int value);
+    void setCe(int value);
+    int getIrq() const;
+    uint64_t nextEvent() const; // virtual ns of the next state change, or UINT64_MAX
+    void runUntil(uint64_t ns);
+};
+
+// The one simulated radio and its clock. Time the CPU spends on SPI and
+// wait_us counts as busy; waiting for the radio does not.
+extern HostRadio host_radio;
+uint64_t hostRadioNowNs();
+uint64_t hostRadioBusyNs();
+void hostRadioAdvance(uint64_t ns); // busy
+bool hostRadioWaitEvent(); // idle until the radio's next state change; false if there is none
+
+#endif // HOST_RADIO_H
@@ -0,0 +1,149 @@
+#include "functions.h"
+#include "host_hal.h"
+#include "stats.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Replays a recorded match through Board::render into the host LCD's software
+// frame at 50 fps, reporting pixel writes per frame and optionally dumping the
+// frames. The final frame can be checked against a golden PPM. The run ends
+// with the same [Stats] line the board prints, for the last STATS_WINDOW frames.
+// usage: render_tool <log.bin> [--dump <dir>] [--every <n>] [--ppm] [--golden <final.ppm>]
+
+#define RENDER_FPS 50
+
+extern LCD_DISCO_F429ZI LCD;
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { return false; }
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) { out.insert(out.end(), chunk, chunk + n); }
+    fclose(f);
+    return true;
+}
+
+// Pixels that differ from a P6 PPM of the frame, or -1 if it cannot be read
+static int diffPPM(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { return -1; }
+    int width, height, maxval;
+    if (fscanf(f, "P6 %d %d %d", &width, &height, &maxval) != 3 || width != HOST_LCD_WIDTH || height != HOST_LCD_HEIGHT) {
+        fclose(f);
+        return -1;
+    }
+    fgetc(f);
+    std::vector<uint8_t> rgb(width * height * 3);
+    size_t n = fread(rgb.data(), 1, rgb.size(), f);
+    fclose(f);
+    if (n != rgb.size()) { return -1; }
+    int differ = 0;
+    for (int i = 0; i < width * height; i++) {
+        uint32_t c = (rgb[3 * i] << 16) | (rgb[3 * i + 1] << 8) | rgb[3 * i + 2];
+        if (c != (LCD.getFrame()[i] & 0xFFFFFF)) { differ++; }
+    }
+    return differ;
+}
+
+int main(int argc, char **argv) {
+    const char* log_path = nullptr;
+    const char* dump_dir = nullptr;
+    const char* golden = nullptr;
+    int every = 1;
+    bool ppm = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) { dump_dir = argv[++i]; }
+        else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) { every = max(1, atoi(argv[++i])); }
+        else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) { golden = argv[++i]; }
+        else if (strcmp(argv[i], "--ppm") == 0) { ppm = true; }
+        else if (!log_path) { log_path = argv[i]; }
+    }
+    if (!log_path) {
+        fprintf(stderr, "usage: %s <log.bin> [--dump <dir>] [--every <n>] [--ppm] [--golden <final.ppm>]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<uint8_t> log;
+    if (!readFile(log_path, log)) {
+        fprintf(stderr, "%s: cannot read\n", log_path);
+        return 1;
+    }
+    ReplayReader reader(log.data(), log.size());
+    if (!reader.valid()) {
+        fprintf(stderr, "%s: not a replay log\n", log_path);
+        return 1;
+    }
+
+    Board board(0, 20, 240, 320);
+    board.setAI1Enabled(reader.flags & REPLAY_FLAG_AI1);
+    board.setAI2Enabled(reader.flags & REPLAY_FLAG_AI2);
+    board.setWireless(false);
+    board.setBallCollisions(reader.flags & REPLAY_FLAG_COLLISIONS);
+    board.startMatch(reader.seed);
+    gfxBuildSprites(board.getBallRadius(), board.paddles[0].getRight() - board.paddles[0].getLeft(),
+                    board.paddles[0].getBottom() - board.paddles[0].getTop());
+    LCD.Clear(LCD_COLOR_BLACK); // as Display::init leaves the buffers
+
+    std::vector<uint64_t> writes;
+    auto frame = [&]() {
+        LCD.resetPixelWrites();
+        stats.beginFrame();
+        board.publishSnapshot(0);
+        board.acquireSnapshot();
+        board.render(1.0f);
+        stats.endFrame();
+        writes.push_back(LCD.getPixelWrites());
+        if (dump_dir && (writes.size() - 1) % every == 0) {
+            std::string path = std::string(dump_dir) + "/frame_" + std::to_string(writes.size() - 1) + (ppm ? ".ppm" : ".png");
+            if (!(ppm ? LCD.writePPM(path.c_str()) : LCD.writePNG(path.c_str()))) {
+                fprintf(stderr, "cannot write %s\n", path.c_str());
+                dump_dir = nullptr;
+            }
+        }
+    };
+
+    uint32_t record_step;
+    InputType type;
+    int arg, arg2;
+    while (reader.next(record_step, type, arg, arg2)) {
+        while (board.getStepCount() < record_step) {
+            uint32_t start = statsCycles();
+            board.step();
+            stats.countPhysics(statsCycles() - start, 1);
+            if (board.getStepCount() % (PHYSICS_HZ / RENDER_FPS) == 0) { frame(); }
+        }
+        if (type == REPLAY_END) { break; }
+        board.queueInput(type, arg);
+    }
+    frame();
+
+    std::vector<uint64_t> sorted = writes;
+    std::sort(sorted.begin(), sorted.end());
+    uint64_t total = 0;
+    int idle = 0;
+    for (uint64_t w : writes) {
+        total += w;
+        if (w == 0) { idle++; }
+    }
+    printf("%s: frames=%zu score=%d-%d\n", log_path, writes.size(), board.getScore1(), board.getScore2());
+    printf("  pixel writes/frame : mean %.0f  p50 %llu  p99 %llu  max %llu\n", (double)total / writes.size(),
+           (unsigned long long)sorted[sorted.size() / 2], (unsigned long long)sorted[sorted.size() * 99 / 100],
+           (unsigned long long)sorted.back());
+    printf("  first frame        : %llu\n", (unsigned long long)writes[0]);
+    printf("  frames with no writes : %d\n", idle);
+    printf("  final frame hash   : %08x\n", LCD.hashFrame());
+    stats.print();
+
+    if (golden) {
+        int differ = diffPPM(golden);
+        if (differ < 0) {
+            fprintf(stderr, "%s: not a %dx%d PPM\n", golden, HOST_LCD_WIDTH, HOST_LCD_HEIGHT);
+            return 1;
+        }
+        printf("  golden %s : %d pixels differ\n", golden, differ);
+        return differ ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "functions.h"
+#include "host_hal.h"
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+// Records synthetic matches and re-simulates recorded ones as fast as possible.
+// usage: replay_tool record <out.bin> [seed] [steps] [collisions]
+//        replay_tool play <log.bin>...
+//
+// Logs captured on the board with REPLAY_RECORD=1 can be fed to `play` after
+// converting the serial hex dump with `xxd -r -p`.
+
+static bool readFile(const char* path, std::vector<uint8_t>& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) { return false; }
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) { out.insert(out.end(), chunk, chunk + n); }
+    fclose(f);
+    return true;
+}
+
+// Human P1 and a random spawn now and then against the P2 AI, so the log
+// exercises both the input path and the AI
+static int record(const char* path, uint32_t seed, uint32_t steps, bool collisions) {
+    static ReplayRecorder recorder;
+    Board board(0, 20, 240, 320);
+    board.setAI1Enabled(false);
+    board.setAI2Enabled(true);
+    board.setWireless(false);
+    board.setBallCollisions(collisions);
+    board.setRecorder(&recorder);
+    board.startMatch(seed);
+
+    uint32_t input_rng = seed ^ 0x9E3779B9;
+    for (uint32_t s = 0; s < steps; s++) {
+        input_rng ^= input_rng << 13;
+        input_rng ^= input_rng >> 17;
+        input_rng ^= input_rng << 5;
+        uint32_t roll = input_rng % 10000; // about 4 presses a second at 200 Hz
+        if (roll < 10) { board.queueInput(INPUT_P1_LEFT); }
+        else if (roll < 20) { board.queueInput(INPUT_P1_RIGHT); }
+        else if (roll < 21) { board.queueInput(INPUT_SPAWN); }
+        board.step();
+    }
+    board.endMatch();
+
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    fwrite(recorder.data(), 1, recorder.size(), f);
+    fclose(f);
+    printf("%s: seed=%u steps=%u bytes=%u%s score=%d-%d\n", path, seed, steps, (unsigned)recorder.size(),
+           recorder.isTruncated() ? " (truncated)" : "", board.getScore1(), board.getScore2());
+    return 0;
+}
+
+static int play(const char* path) {
+    std::vector<uint8_t> log;
+    if (!readFile(path, log)) {
+        fprintf(stderr, "%s: cannot read\n", path);
+        return 1;
+    }
+    ReplayReader reader(log.data(), log.size());
+    if (!reader.valid()) {
+        fprintf(stderr, "%s: not a replay log\n", path);
+        return 1;
+    }
+    if (reader.physics_hz != PHYSICS_HZ || !(reader.flags & REPLAY_FLAG_FIXED_POINT) != !FIXED_POINT_PHYSICS) {
+        fprintf(stderr, "%s: recorded at %u Hz %s, this build is %u Hz %s\n", path, reader.physics_hz,
+                (reader.flags & REPLAY_FLAG_FIXED_POINT) ? "Q16.16" : "float", PHYSICS_HZ, FIXED_POINT_PHYSICS ? "Q16.16" : "float");
+        return 1;
+    }
+
+    Board board(0, 20, 240, 320);
+    board.setAI1Enabled(reader.flags & REPLAY_FLAG_AI1);
+    board.setAI2Enabled(reader.flags & REPLAY_FLAG_AI2);
+    board.setWireless(false); // the slave's paddle comes from the log, not the radio
+    board.setBallCollisions(reader.flags & REPLAY_FLAG_COLLISIONS);
+    board.startMatch(reader.seed);
+
+    uint32_t record_step;
+    InputType type;
+    int arg, arg2;
+    bool ended = false;
+    int result = 0;
+    auto start = std::chrono::steady_clock::now();
+    while (reader.next(record_step, type, arg, arg2)) {
+        while (board.getStepCount() < record_step) { board.step(); }
+        if (type == REPLAY_END) {
+            ended = true;
+            if (board.getScore1() != arg || board.getScore2() != arg2) {
+                fprintf(stderr, "%s: DIVERGED, recorded %d-%d, replayed %d-%d\n", path, arg, arg2, board.getScore1(), board.getScore2());
+                result = 1;
+            }
+            break;
+        }
+        board.queueInput(type, arg);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(end - start).count();
+    uint32_t steps = board.getStepCount();
+
+    printf("%s: steps=%u score=%d-%d%s\n", path, steps, board.getScore1(), board.getScore2(), ended ? "" : " (no end record)");
+    printf("  elapsed : %.3f s\n", secs);
+    printf("  steps/s : %.0f\n", steps / secs);
+    printf("  speedup : %.0fx real time\n", steps / (double)PHYSICS_HZ / secs);
+    return result;
+}
+
+int main(int argc, char **argv) {
+    if (argc >= 3 && strcmp(argv[1], "record") == 0) {
+        uint32_t seed = argc > 3 ? strtoul(argv[3], nullptr, 0) : 1;
+        uint32_t steps = argc > 4 ? strtoul(argv[4], nullptr, 0) : PHYSICS_HZ * 600;
+        bool collisions = argc > 5 ? atoi(argv[5]) != 0 : false;
+        hostSeedRng(seed);
+        return record(argv[2], seed, steps, collisions);
+    }
+    if (argc >= 3 && strcmp(argv[1], "play") == 0) {
+        int result = 0;
+        for (int i = 2; i < argc; i++) { result |= play(argv[i]); }
+        return result;
+    }
+    fprintf(stderr, "usage: %s record <out.bin> [seed] [steps] [collisions]\n", argv[0]);
+    fprintf(stderr, "       %s play <log.bin>...\n", argv[0]);
+    return 2;
+}
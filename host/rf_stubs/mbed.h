@@ -0,0 +1,126 @@
+#ifndef HOST_RF_MBED_H
+#define HOST_RF_MBED_H
+
+// Host stand-in for the parts of mbed-os the nRF24L01P driver uses, wired to
+// the simulated radio in host_radio.cpp on the board's pins (main.cpp): CSN
+// on PE_11, CE on PE_9 and IRQ on PE_4. SPI bytes and wait_us advance its
+// virtual clock.
+
+#include "host_radio.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <deque>
+#include <functional>
+
+typedef enum {
+    NC = -1,
+    PE_4, PE_9, PE_11, PE_12, PE_13, PE_14,
+} PinName;
+
+inline void wait_us(int us) { hostRadioAdvance((uint64_t)us * 1000); }
+
+inline void error(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+namespace mbed {
+
+template <typename F> class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)> {
+public:
+    Callback() {}
+    template <typename F>
+    Callback(F f) : func(f) {}
+    R operator()(Args... args) const { return func(args...); }
+    explicit operator bool() const { return (bool)func; }
+private:
+    std::function<R(Args...)> func;
+};
+
+template <typename T, typename R, typename... Args>
+Callback<R(Args...)> callback(T* obj, R (T::*method)(Args...)) {
+    return Callback<R(Args...)>([obj, method](Args... args) { return (obj->*method)(args...); });
+}
+
+class SPI {
+public:
+    SPI(PinName mosi, PinName miso, PinName sck) : byteNs(4000) {}
+    void frequency(int hz) { byteNs = 8000000000ULL / hz; }
+    void format(int bits, int mode) {}
+    int write(int value) {
+        int out = host_radio.transfer(value);
+        hostRadioAdvance(byteNs);
+        return out;
+    }
+private:
+    uint64_t byteNs;
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : pin(pin), value(0) {}
+    DigitalOut& operator=(int v) {
+        value = v;
+        if (pin == PE_11) { host_radio.setCsn(v); }
+        if (pin == PE_9) { host_radio.setCe(v); }
+        return *this;
+    }
+    operator int() const { return value; }
+private:
+    PinName pin;
+    int value;
+};
+
+class InterruptIn {
+public:
+    InterruptIn(PinName pin) : pin(pin) {}
+    void fall(Callback<void()> func) {
+        isr = func;
+        if (pin == PE_4) {
+            host_radio.irqCallback = &InterruptIn::fire;
+            host_radio.irqContext = this;
+        }
+    }
+    int read() { return pin == PE_4 ? host_radio.getIrq() : 1; }
+private:
+    static void fire(void* self) { ((InterruptIn*)self)->isr(); }
+    PinName pin;
+    Callback<void()> isr;
+};
+
+// Events run when the host calls dispatch_once, which also runs anything they post
+class EventQueue {
+public:
+    int call(Callback<void()> func) {
+        events.push_back(func);
+        return 1;
+    }
+    void dispatch_once() {
+        while (!events.empty()) {
+            Callback<void()> func = events.front();
+            events.pop_front();
+            func();
+        }
+    }
+private:
+    std::deque<Callback<void()>> events;
+};
+
+class Mutex {
+public:
+    void lock() {}
+    void unlock() {}
+};
+
+} // namespace mbed
+
+using namespace mbed;
+
+#endif // HOST_RF_MBED_H
@@ -0,0 +1,59 @@
+#ifndef HOST_LCD_DISCO_F429ZI_H
+#define HOST_LCD_DISCO_F429ZI_H
+
+// Host stand-in for LCD_DISCO_F429ZI. Mirrors the subset of the driver API the
+// game uses, drawing into an in-memory 240x320 ARGB8888 frame the way the BSP
+// does (same circle algorithm, same fonts, same unclipped addressing), so
+// renders can be dumped, diffed and measured off the board (host_lcd.cpp).
+
+#include "mbed.h"
+#include "fonts.h"
+
+#define LCD_COLOR_WHITE         0xFFFFFFFF
+#define LCD_COLOR_BLACK         0xFF000000
+
+#define HOST_LCD_WIDTH 240
+#define HOST_LCD_HEIGHT 320
+
+typedef enum {
+    CENTER_MODE = 0x01,
+    RIGHT_MODE  = 0x02,
+    LEFT_MODE   = 0x03,
+} Text_AlignModeTypdef;
+
+class LCD_DISCO_F429ZI {
+private:
+    uint32_t frame[HOST_LCD_WIDTH * HOST_LCD_HEIGHT];
+    uint32_t textColor;
+    uint32_t backColor;
+    sFONT* font;
+    uint64_t pixelWrites;
+    void drawChar(uint16_t Xpos, uint16_t Ypos, const uint8_t* c);
+public:
+    LCD_DISCO_F429ZI();
+    uint32_t GetXSize() const { return HOST_LCD_WIDTH; }
+    uint32_t GetYSize() const { return HOST_LCD_HEIGHT; }
+    void Clear(uint32_t Color);
+    void SetTextColor(uint32_t Color) { textColor = Color; }
+    void SetBackColor(uint32_t Color) { backColor = Color; }
+    void SetFont(sFONT *fonts) { font = fonts; }
+    sFONT* GetFont() const { return font; }
+    void DisplayChar(uint16_t Xpos, uint16_t Ypos, uint8_t Ascii);
+    void DisplayStringAt(uint16_t X, uint16_t Y, uint8_t *pText, Text_AlignModeTypdef mode);
+    void DrawPixel(uint16_t Xpos, uint16_t Ypos, uint32_t RGB_Code);
+    uint32_t ReadPixel(uint16_t Xpos, uint16_t Ypos) const;
+    void DrawHLine(uint16_t Xpos, uint16_t Ypos, uint16_t Length);
+    void DrawCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
+    void FillRect(uint16_t Xpos, uint16_t Ypos, uint16_t Width, uint16_t Height);
+    void FillCircle(uint16_t Xpos, uint16_t Ypos, uint16_t Radius);
+
+    // host only
+    const uint32_t* getFrame() const { return frame; }
+    uint64_t getPixelWrites() const { return pixelWrites; }
+    void resetPixelWrites() { pixelWrites = 0; }
+    uint32_t hashFrame() const;
+    bool writePPM(const char* path) const;
+    bool writePNG(const char* path) const;
+};
+
+#endif // HOST_LCD_DISCO_F429ZI_H
@@ -0,0 +1,48 @@
+#ifndef HOST_MBED_H
+#define HOST_MBED_H
+
+// Host stand-in for the parts of mbed-os used by the game engine. Only what
+// functions.cpp touches is provided; everything hardware-facing is a no-op.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <algorithm>
+
+typedef enum {
+    NC = -1,
+    PA_5, PA_6, PA_7, PE_9, PE_11, PE_12, PE_13, PE_14,
+    PG_2, PG_3, PG_13, PG_14, PH_1, BUTTON1,
+} PinName;
+
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+namespace mbed {
+
+class Ticker {
+public:
+    template <typename F, typename D>
+    void attach(F func, D period) { attached = true; }
+    void detach() { attached = false; }
+    bool attached = false;
+};
+
+class DigitalOut {
+public:
+    DigitalOut(PinName pin) : value(0) {}
+    DigitalOut& operator=(int v) { value = v; return *this; }
+    operator int() const { return value; }
+private:
+    int value;
+};
+
+} // namespace mbed
+
+inline void wait_us(int us) {}
+
+using namespace mbed;
+using namespace std;
+
+#endif // HOST_MBED_H
@@ -0,0 +1,40 @@
+#include "functions.h"
+#include "host_hal.h"
+
+// PongAI target selection with a ball already past the paddle line. Run by ctest.
+
+static int failures = 0;
+
+static void check(bool ok, const char* what, float target, float expected) {
+    printf("%s %s: target %.1f, expected %.1f\n", ok ? "PASS" : "FAIL", what, target, expected);
+    if (!ok) { failures++; }
+}
+
+// a few AI ticks for the bottom paddle, so the reaction latency has passed
+static float bottomTarget(Board& board, const BallPool& balls) {
+    PongAI ai;
+    ai.setDifficulty(1, 10); // no aim error
+    for (int t = 0; t < 4; t++) { ai.update(board, balls, false, true); }
+    return ai.getTarget(1);
+}
+
+int main() {
+    hostSeedRng(1);
+    Board board(0, 20, 240, 320);
+    float line = board.paddles[1].getTop();
+    float middle = (board.getMinWidth() + board.getMaxWidth()) / 2.0f;
+
+    // one ball lost behind the bottom paddle, one still coming at it
+    BallPool balls;
+    balls.place(0, 30, line + 4, 0, 1);
+    balls.place(1, 200, 200, 0, 1);
+    float target = bottomTarget(board, balls);
+    check(fabsf(target - 200) < 1, "goes for the incoming ball", target, 200);
+
+    // the lost ball alone is nothing to play
+    balls.despawn(1);
+    target = bottomTarget(board, balls);
+    check(fabsf(target - middle) < 1, "drifts to the middle", target, middle);
+
+    return failures ? 1 : 0;
+}
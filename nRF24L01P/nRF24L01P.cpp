@@ -136,6 +136,8 @@ typedef enum {
 
 // SETUP_RETR register:
 #define _NRF24L01P_SETUP_RETR_NONE       0
+#define _NRF24L01P_SETUP_RETR_ARD_SHIFT  4
+#define _NRF24L01P_SETUP_RETR_ARC_MASK   0xF
 
 // RF_SETUP register:
 #define _NRF24L01P_RF_SETUP_RF_PWR_MASK          (0x3<<1)
@@ -158,6 +160,17 @@ typedef enum {
 #define _NRF24L01P_STATUS_TX_DS          (1<<5)
 #define _NRF24L01P_STATUS_RX_DR          (1<<6)
 
+// FIFO_STATUS register:
+#define _NRF24L01P_FIFO_STATUS_RX_EMPTY  (1<<0)
+#define _NRF24L01P_FIFO_STATUS_RX_FULL   (1<<1)
+#define _NRF24L01P_FIFO_STATUS_TX_EMPTY  (1<<4)
+#define _NRF24L01P_FIFO_STATUS_TX_FULL   (1<<5)
+
+// FEATURE register:
+#define _NRF24L01P_FEATURE_EN_DYN_ACK    (1<<0)
+#define _NRF24L01P_FEATURE_EN_ACK_PAY    (1<<1)
+#define _NRF24L01P_FEATURE_EN_DPL        (1<<2)
+
 // RX_PW_P0..RX_PW_P5 registers:
 #define _NRF24L01P_RX_PW_Px_MASK         0x3F
 
@@ -166,6 +179,7 @@ typedef enum {
 #define _NRF24L01P_TIMING_Thce_us              10   //  10uS
 #define _NRF24L01P_TIMING_Tpd2stby_us        4500   // 4.5mS worst case
 #define _NRF24L01P_TIMING_Tpece2csn_us          4   //   4uS
+#define _NRF24L01P_TIMING_Ttx_max_us         4000   //   4mS, longest stretch in TX mode without Enhanced ShockBurst
 
 /**
  * Methods
@@ -176,10 +190,24 @@ nRF24L01P::nRF24L01P(PinName mosi,
                      PinName sck, 
                      PinName csn,
                      PinName ce,
-                     PinName irq) : spi_(mosi, miso, sck), nCS_(csn), ce_(ce), nIRQ_(irq) {
+                     PinName irq) : spi_(mosi, miso, sck), nCS_(csn), ce_(ce), nIRQ_(irq), irqPin_(irq) {
 
     mode = _NRF24L01P_MODE_UNKNOWN;
 
+    queue_ = NULL;
+    txHead_ = 0;
+    txSize_ = 0;
+    txInFifo_ = 0;
+    txStreaming_ = false;
+    txBurst_ = 0;
+    txBurstLimit_ = 1;
+    txModeBefore_ = _NRF24L01P_MODE_UNKNOWN;
+    txCeBefore_ = 0;
+    rxHead_ = 0;
+    rxSize_ = 0;
+    ackCount_ = 0;
+    ackPipe_ = NRF24L01P_PIPE_P0;
+
     disable();
 
     nCS_ = 1;
@@ -555,6 +583,45 @@ void nRF24L01P::disableAutoRetransmit(void) {
 
 }
 
+
+void nRF24L01P::enableAutoRetransmit(int delay, int count) {
+
+    if ( ( delay < 250 ) || ( delay > 4000 ) ) {
+
+        error( "nRF24L01P: Invalid AutoRetransmit delay %d uS\r\n", delay );
+        return;
+
+    }
+
+    if ( ( count < 1 ) || ( count > 15 ) ) {
+
+        error( "nRF24L01P: Invalid AutoRetransmit count %d\r\n", count );
+        return;
+
+    }
+
+    int ard = ( delay / 250 ) - 1;
+
+    setRegister(_NRF24L01P_REG_SETUP_RETR, ( ard << _NRF24L01P_SETUP_RETR_ARD_SHIFT ) | ( count & _NRF24L01P_SETUP_RETR_ARC_MASK ));
+
+}
+
+
+void nRF24L01P::enableAckPayload(void) {
+
+    int feature = getRegister(_NRF24L01P_REG_FEATURE);
+
+    feature |= _NRF24L01P_FEATURE_EN_DPL | _NRF24L01P_FEATURE_EN_ACK_PAY;
+
+    setRegister(_NRF24L01P_REG_FEATURE, feature);
+
+    //
+    // Dynamic payload length on every pipe: an ACK payload can be any size
+    //
+    setRegister(_NRF24L01P_REG_DYNPD, 0x3F);
+
+}
+
 void nRF24L01P::setRxAddress(unsigned long long address, int width, int pipe) {
 
     if ( ( pipe < NRF24L01P_PIPE_P0 ) || ( pipe > NRF24L01P_PIPE_P5 ) ) {
@@ -827,6 +894,18 @@ bool nRF24L01P::readable(int pipe) {
 
     }
 
+    if ( queue_ ) {
+
+        //
+        // Interrupt-driven: the payloads have already been drained
+        //
+        bufferLock_.lock();
+        bool ready = ( rxSize_ > 0 ) && ( rxPipe_[rxHead_] == pipe );
+        bufferLock_.unlock();
+        return ready;
+
+    }
+
     int status = getStatusRegister();
 
     return ( ( status & _NRF24L01P_STATUS_RX_DR ) && ( ( ( status & _NRF24L01P_STATUS_RX_P_NO ) >> 1 ) == ( pipe & 0x7 ) ) );
@@ -870,14 +949,29 @@ int nRF24L01P::write(int pipe, char *data, int count) {
     wait_us(_NRF24L01P_TIMING_Thce_us);
     disable();
 
-    while ( !( getStatusRegister() & _NRF24L01P_STATUS_TX_DS ) ) {
+    int txStatus;
+
+    while ( !( ( txStatus = getStatusRegister() ) & ( _NRF24L01P_STATUS_TX_DS | _NRF24L01P_STATUS_MAX_RT ) ) ) {
 
-        // Wait for the transfer to complete
+        // Wait for the transfer to complete (or, with auto acknowledge, to give up)
 
     }
 
-    // Clear the Status bit
-    setRegister(_NRF24L01P_REG_STATUS, _NRF24L01P_STATUS_TX_DS);
+    // Clear the Status bits
+    setRegister(_NRF24L01P_REG_STATUS, _NRF24L01P_STATUS_TX_DS|_NRF24L01P_STATUS_MAX_RT);
+
+    if ( txStatus & _NRF24L01P_STATUS_MAX_RT ) {
+
+        // The payload stays in the TX FIFO after MAX_RT
+        nCS_ = 0;
+
+        status = spi_.write(_NRF24L01P_SPI_CMD_FLUSH_TX);
+
+        nCS_ = 1;
+
+        count = -1;
+
+    }
 
     if ( originalMode == _NRF24L01P_MODE_RX ) {
 
@@ -906,6 +1000,30 @@ int nRF24L01P::read(int pipe, char *data, int count) {
 
     if ( count > _NRF24L01P_RX_FIFO_SIZE ) count = _NRF24L01P_RX_FIFO_SIZE;
 
+    if ( queue_ ) {
+
+        bufferLock_.lock();
+
+        if ( ( rxSize_ == 0 ) || ( rxPipe_[rxHead_] != pipe ) ) {
+
+            bufferLock_.unlock();
+            return 0;
+
+        }
+
+        if ( rxCount_[rxHead_] < count ) count = rxCount_[rxHead_];
+
+        memcpy(data, rxBuffer_[rxHead_], count);
+
+        rxHead_ = ( rxHead_ + 1 ) % _NRF24L01P_RX_FIFO_COUNT;
+        rxSize_--;
+
+        bufferLock_.unlock();
+
+        return count;
+
+    }
+
     if ( readable(pipe) ) {
 
         nCS_ = 0;
@@ -976,6 +1094,438 @@ int nRF24L01P::read(int pipe, char *data, int count) {
 
 }
 
+bool nRF24L01P::enableInterrupts(EventQueue *queue) {
+
+    if ( irqPin_ == NC ) return false;
+
+    queue_ = queue;
+
+    nIRQ_.fall(callback(this, &nRF24L01P::irqHandler));
+
+    //
+    // The line only falls on a new event, so pick up anything already pending
+    //
+    queue_->call(callback(this, &nRF24L01P::handleInterrupt));
+
+    return true;
+
+}
+
+
+int nRF24L01P::writeAsync(int pipe, char *data, int count) {
+
+    if ( !queue_ ) return write(pipe, data, count);
+
+    if ( poll() > 0 ) return 0;
+
+    return enqueue(pipe, data, count);
+
+}
+
+
+int nRF24L01P::enqueue(int pipe, char *data, int count) {
+
+    // Note: the pipe number is ignored in a Transmit / write
+
+    if ( count <= 0 ) return 0;
+
+    if ( count > _NRF24L01P_TX_FIFO_SIZE ) count = _NRF24L01P_TX_FIFO_SIZE;
+
+    bufferLock_.lock();
+
+    if ( txSize_ == NRF24L01P_TX_QUEUE_DEPTH ) {
+
+        bufferLock_.unlock();
+        return 0;
+
+    }
+
+    int slot = ( txHead_ + txSize_ ) % NRF24L01P_TX_QUEUE_DEPTH;
+
+    memcpy(txQueue_[slot], data, count);
+    txCount_[slot] = count;
+    txSize_++;
+
+    bufferLock_.unlock();
+
+    if ( queue_ ) {
+
+        queue_->call(callback(this, &nRF24L01P::startTransmit));
+
+    } else {
+
+        poll();
+
+    }
+
+    return count;
+
+}
+
+
+int nRF24L01P::poll(void) {
+
+    if ( !queue_ ) {
+
+        int flags = getStatusRegister() & ( _NRF24L01P_STATUS_MAX_RT | _NRF24L01P_STATUS_TX_DS );
+
+        if ( flags ) setRegister(_NRF24L01P_REG_STATUS, flags);
+
+        pumpTransmit(flags);
+
+    }
+
+    bufferLock_.lock();
+    int pending = txSize_ + txInFifo_;
+    bufferLock_.unlock();
+
+    return pending;
+
+}
+
+
+int nRF24L01P::writeAckPayload(int pipe, char *data, int count) {
+
+    if ( ( pipe < NRF24L01P_PIPE_P0 ) || ( pipe > NRF24L01P_PIPE_P5 ) ) {
+
+        error( "nRF24L01P: Invalid ACK payload pipe number %d\r\n", pipe );
+        return -1;
+
+    }
+
+    if ( count <= 0 ) return 0;
+
+    if ( count > _NRF24L01P_TX_FIFO_SIZE ) count = _NRF24L01P_TX_FIFO_SIZE;
+
+    bufferLock_.lock();
+
+    memcpy(ackBuffer_, data, count);
+    ackCount_ = count;
+    ackPipe_ = pipe;
+
+    bufferLock_.unlock();
+
+    if ( queue_ ) {
+
+        queue_->call(callback(this, &nRF24L01P::loadAckPayload));
+
+    } else {
+
+        loadAckPayload();
+
+    }
+
+    return count;
+
+}
+
+
+void nRF24L01P::loadAckPayload(void) {
+
+    bufferLock_.lock();
+
+    if ( ackCount_ == 0 ) {
+
+        bufferLock_.unlock();
+        return;
+
+    }
+
+    //
+    // Only the newest payload matters, so drop any that have not gone yet
+    //
+    nCS_ = 0;
+
+    int status = spi_.write(_NRF24L01P_SPI_CMD_FLUSH_TX);
+
+    nCS_ = 1;
+
+    nCS_ = 0;
+
+    status = spi_.write(_NRF24L01P_SPI_CMD_W_ACK_PAYLOAD | ( ackPipe_ & 0x7 ));
+
+    for ( int i = 0; i < ackCount_; i++ ) {
+
+        spi_.write(ackBuffer_[i]);
+
+    }
+
+    nCS_ = 1;
+
+    ackCount_ = 0;
+
+    bufferLock_.unlock();
+
+}
+
+
+void nRF24L01P::attachTransmitDone(Callback<void()> func) {
+
+    txDoneCallback_ = func;
+
+}
+
+
+void nRF24L01P::attachMaxRetransmit(Callback<void()> func) {
+
+    maxRtCallback_ = func;
+
+}
+
+
+void nRF24L01P::attachReceive(Callback<void(int)> func) {
+
+    rxCallback_ = func;
+
+}
+
+
+void nRF24L01P::irqHandler(void) {
+
+    queue_->call(callback(this, &nRF24L01P::handleInterrupt));
+
+}
+
+
+void nRF24L01P::startTransmit(void) {
+
+    pumpTransmit(0);
+
+}
+
+
+void nRF24L01P::pumpTransmit(int flags) {
+
+    if ( flags & _NRF24L01P_STATUS_MAX_RT ) {
+
+        //
+        // The payload stays in the TX FIFO after MAX_RT; give up on all of it
+        //
+        nCS_ = 0;
+
+        int status = spi_.write(_NRF24L01P_SPI_CMD_FLUSH_TX);
+
+        nCS_ = 1;
+
+    }
+
+    if ( !txStreaming_ ) {
+
+        bufferLock_.lock();
+        int queued = txSize_;
+        bufferLock_.unlock();
+
+        if ( queued == 0 ) {
+
+            if ( ( flags & _NRF24L01P_STATUS_TX_DS ) && txDoneCallback_ ) txDoneCallback_();
+            if ( ( flags & _NRF24L01P_STATUS_MAX_RT ) && maxRtCallback_ ) maxRtCallback_();
+            return;
+
+        }
+
+        //
+        // Start a burst: into TX mode with CE low while the FIFO is loaded
+        //
+        txModeBefore_ = mode;
+        txCeBefore_ = ce_;
+        disable();
+
+        setRegister(_NRF24L01P_REG_STATUS, _NRF24L01P_STATUS_MAX_RT|_NRF24L01P_STATUS_TX_DS);
+        setTransmitMode();
+
+        //
+        // Bits on air for a full payload: preamble, address, payload, CRC
+        //  and the 9-bit packet control field
+        //
+        int bits = ( 1 + DEFAULT_NRF24L01P_ADDRESS_WIDTH + _NRF24L01P_TX_FIFO_SIZE + getCrcWidth() / 8 ) * 8 + 9;
+        int airtime_us = bits * 1000 / getAirDataRate();
+        txBurstLimit_ = ( _NRF24L01P_TIMING_Ttx_max_us - _NRF24L01P_TIMING_Tstby2a_us ) / airtime_us;
+        if ( txBurstLimit_ < 1 ) txBurstLimit_ = 1;
+
+        txBurst_ = 0;
+        txInFifo_ = 0;
+        txStreaming_ = true;
+
+    }
+
+    //
+    // The FIFO only tells empty, full or in between
+    //
+    int fifoStatus = getRegister(_NRF24L01P_REG_FIFO_STATUS);
+
+    int inFifo = txInFifo_;
+
+    if ( ( fifoStatus & _NRF24L01P_FIFO_STATUS_TX_EMPTY ) || ( flags & _NRF24L01P_STATUS_MAX_RT ) ) {
+
+        inFifo = 0;
+
+    } else if ( !( fifoStatus & _NRF24L01P_FIFO_STATUS_TX_FULL ) && ( inFifo == _NRF24L01P_TX_FIFO_COUNT ) ) {
+
+        inFifo = _NRF24L01P_TX_FIFO_COUNT - 1;
+
+    }
+
+    //
+    // A burst that has used up the TX mode limit is left to drain; the next
+    //  payload then starts from Standby-II, where the PLL relocks
+    //
+    if ( inFifo == 0 ) txBurst_ = 0;
+
+    bufferLock_.lock();
+
+    while ( ( txSize_ > 0 ) && ( inFifo < _NRF24L01P_TX_FIFO_COUNT ) && ( txBurst_ < txBurstLimit_ ) ) {
+
+        nCS_ = 0;
+
+        int status = spi_.write(_NRF24L01P_SPI_CMD_WR_TX_PAYLOAD);
+
+        for ( int i = 0; i < txCount_[txHead_]; i++ ) {
+
+            spi_.write(txQueue_[txHead_][i]);
+
+        }
+
+        nCS_ = 1;
+
+        txHead_ = ( txHead_ + 1 ) % NRF24L01P_TX_QUEUE_DEPTH;
+        txSize_--;
+        inFifo++;
+        txBurst_++;
+
+    }
+
+    txInFifo_ = inFifo;
+    int queued = txSize_;
+
+    bufferLock_.unlock();
+
+    if ( inFifo > 0 ) {
+
+        //
+        // CE stays high: the FIFO goes out back-to-back
+        //
+        if ( !ce_ ) enable();
+
+    } else if ( queued == 0 ) {
+
+        //
+        // All sent: back to where the burst found the radio
+        //
+        disable();
+
+        if ( txModeBefore_ == _NRF24L01P_MODE_RX ) {
+
+            setReceiveMode();
+
+        }
+
+        ce_ = txCeBefore_;
+        wait_us( _NRF24L01P_TIMING_Tpece2csn_us );
+
+        txStreaming_ = false;
+
+    }
+
+    if ( ( flags & _NRF24L01P_STATUS_TX_DS ) && txDoneCallback_ ) txDoneCallback_();
+    if ( ( flags & _NRF24L01P_STATUS_MAX_RT ) && maxRtCallback_ ) maxRtCallback_();
+
+}
+
+
+void nRF24L01P::handleInterrupt(void) {
+
+    //
+    // Loop while the line is still low: a flag raised after STATUS was read
+    //  keeps it there, and would never give another falling edge
+    //
+    do {
+
+        int status = getStatusRegister();
+
+        int flags = status & ( _NRF24L01P_STATUS_MAX_RT | _NRF24L01P_STATUS_TX_DS | _NRF24L01P_STATUS_RX_DR );
+
+        if ( !flags ) break;
+
+        setRegister(_NRF24L01P_REG_STATUS, flags);
+
+        if ( flags & _NRF24L01P_STATUS_RX_DR ) {
+
+            //
+            // Drain the whole RX FIFO, since RX_DR was cleared for all of it
+            //
+            while ( !( getRegister(_NRF24L01P_REG_FIFO_STATUS) & _NRF24L01P_FIFO_STATUS_RX_EMPTY ) ) {
+
+                int pipe = ( getStatusRegister() & _NRF24L01P_STATUS_RX_P_NO ) >> 1;
+
+                nCS_ = 0;
+
+                status = spi_.write(_NRF24L01P_SPI_CMD_R_RX_PL_WID);
+
+                int rxPayloadWidth = spi_.write(_NRF24L01P_SPI_CMD_NOP);
+
+                nCS_ = 1;
+
+                if ( ( rxPayloadWidth < 0 ) || ( rxPayloadWidth > _NRF24L01P_RX_FIFO_SIZE ) ) {
+
+                    nCS_ = 0;
+
+                    status = spi_.write(_NRF24L01P_SPI_CMD_FLUSH_RX);
+
+                    nCS_ = 1;
+
+                    break;
+
+                }
+
+                bufferLock_.lock();
+
+                //
+                // A full buffer drops its oldest payload
+                //
+                if ( rxSize_ == _NRF24L01P_RX_FIFO_COUNT ) {
+
+                    rxHead_ = ( rxHead_ + 1 ) % _NRF24L01P_RX_FIFO_COUNT;
+                    rxSize_--;
+
+                }
+
+                int slot = ( rxHead_ + rxSize_ ) % _NRF24L01P_RX_FIFO_COUNT;
+
+                nCS_ = 0;
+
+                status = spi_.write(_NRF24L01P_SPI_CMD_RD_RX_PAYLOAD);
+
+                for ( int i = 0; i < rxPayloadWidth; i++ ) {
+
+                    rxBuffer_[slot][i] = spi_.write(_NRF24L01P_SPI_CMD_NOP);
+
+                }
+
+                nCS_ = 1;
+
+                rxCount_[slot] = rxPayloadWidth;
+                rxPipe_[slot] = pipe;
+                rxSize_++;
+
+                bufferLock_.unlock();
+
+                if ( rxCallback_ ) rxCallback_(pipe);
+
+            }
+
+        }
+
+        if ( flags & ( _NRF24L01P_STATUS_TX_DS | _NRF24L01P_STATUS_MAX_RT ) ) {
+
+            pumpTransmit(flags & ( _NRF24L01P_STATUS_TX_DS | _NRF24L01P_STATUS_MAX_RT ));
+
+        }
+
+    } while ( nIRQ_.read() == 0 );
+
+}
+
+
 void nRF24L01P::setRegister(int regAddress, int regData) {
 
     //
@@ -78,6 +78,10 @@
 #define DEFAULT_NRF24L01P_TX_PWR         NRF24L01P_TX_PWR_ZERO_DB
 #define DEFAULT_NRF24L01P_TRANSFER_SIZE  4
 
+#ifndef NRF24L01P_TX_QUEUE_DEPTH
+#define NRF24L01P_TX_QUEUE_DEPTH         8  // payloads enqueue can hold on top of the 3-deep TX FIFO
+#endif
+
 /**
  * nRF24L01+ Single Chip 2.4GHz Transceiver from Nordic Semiconductor.
  */
@@ -278,6 +282,75 @@ public:
      */
     bool readable(int pipe = NRF24L01P_PIPE_P0);
 
+    /**
+     * Switch to interrupt-driven operation (needs the IRQ pin connected)
+     *
+     * The IRQ line only posts an event to the queue; the STATUS register is
+     *  read and TX_DS, RX_DR and MAX_RT handled on the thread dispatching it.
+     *  From then on all SPI traffic happens there: enqueue hands its
+     *  payloads over, received payloads are drained into a buffer, and
+     *  readable/read serve that buffer without touching the bus. Use
+     *  enqueue or writeAsync rather than write from then on.
+     *
+     * @param queue the event queue to handle interrupts on
+     * @return false if there is no IRQ pin
+     */
+    bool enableInterrupts(EventQueue *queue);
+
+    /**
+     * Transmit data without waiting for it to go out
+     *
+     * Without interrupts enabled this is the same as write.
+     *
+     * @param pipe is ignored (included for consistency with file write routine)
+     * @param data pointer to an array of bytes to write
+     * @param count the number of bytes to send (1..32)
+     * @return the number of bytes queued, or 0 if the previous packet is still in flight
+     */
+    int writeAsync(int pipe, char *data, int count);
+
+    /**
+     * Queue data for pipelined transmission
+     *
+     * Queued payloads are streamed back-to-back: the radio stays in TX mode
+     *  with CE high while the 3-deep TX FIFO is kept topped up, so only the
+     *  first packet of a burst pays the TX settling time, and it returns to
+     *  its previous mode once everything has gone. Without interrupts the
+     *  FIFO is only topped up by calls to poll (this one included).
+     *
+     * @param pipe is ignored (included for consistency with file write routine)
+     * @param data pointer to an array of bytes to write
+     * @param count the number of bytes to send (1..32)
+     * @return the number of bytes queued, or 0 if the queue is full
+     */
+    int enqueue(int pipe, char *data, int count);
+
+    /**
+     * Service the transmit queue
+     *
+     * Without interrupts this tops up the TX FIFO and must be called
+     *  regularly while anything is queued. With interrupts it only reports.
+     *
+     * @return the number of payloads not yet sent
+     */
+    int poll(void);
+
+    /**
+     * Set the function called (on the event queue) when a packet has been sent
+     */
+    void attachTransmitDone(Callback<void()> func);
+
+    /**
+     * Set the function called (on the event queue) when auto retransmit gives up
+     */
+    void attachMaxRetransmit(Callback<void()> func);
+
+    /**
+     * Set the function called (on the event queue) for each packet received,
+     *  with its pipe
+     */
+    void attachReceive(Callback<void(int)> func);
+
     /**
      * Disable all receive pipes
      *
@@ -310,6 +383,27 @@ public:
      */
     void enableAutoRetransmit(int delay, int count);
 
+    /**
+     * Enable ACK payloads (and the dynamic payload length they need)
+     *
+     * Both ends need this, along with auto acknowledge on the pipe. The
+     *  payload a PRX loads with writeAckPayload goes back inside the next
+     *  ACK, and the PTX receives it like any packet on that pipe.
+     */
+    void enableAckPayload(void);
+
+    /**
+     * Load the payload for the next ACK on a pipe (PRX only)
+     *
+     * Replaces any ACK payload that has not gone out yet.
+     *
+     * @param pipe the pipe whose next ACK carries it
+     * @param data pointer to an array of bytes to send
+     * @param count the number of bytes to send (1..32)
+     * @return the number of bytes loaded, or -1 for an error
+     */
+    int writeAckPayload(int pipe, char *data, int count);
+
 private:
 
     /**
@@ -335,13 +429,71 @@ private:
      */
     int getStatusRegister(void);
 
+    /**
+     * IRQ line ISR: defers to handleInterrupt on the event queue
+     */
+    void irqHandler(void);
+
+    /**
+     * Read STATUS, clear it and act on each flag that was set
+     */
+    void handleInterrupt(void);
+
+    /**
+     * Act on TX_DS/MAX_RT (already cleared), top up the TX FIFO from the
+     *  queue, and leave TX mode once both are empty
+     *
+     * @param flags the TX_DS and MAX_RT bits seen in STATUS
+     */
+    void pumpTransmit(int flags);
+
+    /**
+     * pumpTransmit with no flags, for the event queue
+     */
+    void startTransmit(void);
+
+    /**
+     * Put the payload handed over by writeAckPayload in the TX FIFO
+     */
+    void loadAckPayload(void);
+
     SPI         spi_;
     DigitalOut  nCS_;
     DigitalOut  ce_;
     InterruptIn nIRQ_;
+    PinName     irqPin_;
 
     int mode;
 
+    // Interrupt-driven mode
+    EventQueue *queue_;
+    Mutex       bufferLock_;
+    Callback<void()>    txDoneCallback_;
+    Callback<void()>    maxRtCallback_;
+    Callback<void(int)> rxCallback_;
+
+    // Transmit queue
+    char txQueue_[NRF24L01P_TX_QUEUE_DEPTH][32];
+    int  txCount_[NRF24L01P_TX_QUEUE_DEPTH];
+    int  txHead_;
+    int  txSize_;
+    int  txInFifo_;         // loaded and not yet sent, as far as FIFO_STATUS tells
+    bool txStreaming_;      // in TX mode for the queue
+    int  txBurst_;          // packets since the FIFO was last empty
+    int  txBurstLimit_;     // packets that fit in the 4ms TX mode limit
+    int  txModeBefore_;
+    int  txCeBefore_;
+
+    char rxBuffer_[3][32];  // one per RX FIFO level
+    int  rxCount_[3];
+    int  rxPipe_[3];
+    int  rxHead_;
+    int  rxSize_;
+
+    char ackBuffer_[32];
+    int  ackCount_;
+    int  ackPipe_;
+
 };
 
 #endif /* __NRF24L01P_H__ */
@@ -0,0 +1,111 @@
+#include "replay.h"
+#include <stdio.h>
+
+// REPLAY RECORDER METHODS
+
+ReplayRecorder::ReplayRecorder() : length(0), lastStep(0), recording(false), truncated(false) {}
+
+bool ReplayRecorder::put(uint8_t byte) {
+    if (length >= REPLAY_BUFFER_SIZE) {
+        truncated = true;
+        recording = false;
+        return false;
+    }
+    buffer[length++] = byte;
+    return true;
+}
+bool ReplayRecorder::putVarint(uint32_t value) {
+    while (value >= 0x80) {
+        if (!put((value & 0x7F) | 0x80)) { return false; }
+        value >>= 7;
+    }
+    return put(value);
+}
+void ReplayRecorder::begin(uint32_t seed, uint8_t flags, uint16_t physics_hz) {
+    length = 0;
+    lastStep = 0;
+    truncated = false;
+    recording = true;
+    put('P');
+    put('R');
+    put(REPLAY_VERSION);
+    put(flags);
+    put(physics_hz & 0xFF);
+    put((physics_hz >> 8) & 0xFF);
+    for (int i = 0; i < 4; i++) { put((seed >> (8 * i)) & 0xFF); }
+}
+void ReplayRecorder::recordInput(uint32_t step, InputType type, uint8_t arg) {
+    if (!recording) { return; }
+    putVarint(step - lastStep);
+    put(type);
+    if (type == INPUT_P2_MOVE_TO) { put(arg); }
+    lastStep = step;
+}
+void ReplayRecorder::end(uint32_t step, int score1, int score2) {
+    if (!recording) { return; }
+    putVarint(step - lastStep);
+    put(REPLAY_END);
+    put(score1 & 0xFF);
+    put((score1 >> 8) & 0xFF);
+    put(score2 & 0xFF);
+    put((score2 >> 8) & 0xFF);
+    recording = false;
+}
+bool ReplayRecorder::isRecording() const { return recording; }
+bool ReplayRecorder::isTruncated() const { return truncated; }
+const uint8_t* ReplayRecorder::data() const { return buffer; }
+size_t ReplayRecorder::size() const { return length; }
+
+// Prints the log as hex, 32 bytes per line, for capture over the serial port
+// (convert back with `xxd -r -p`)
+void ReplayRecorder::dump() const {
+    printf("[Replay] %u bytes%s\n", (unsigned)length, truncated ? " (truncated)" : "");
+    for (size_t i = 0; i < length; i++) {
+        printf("%02X", buffer[i]);
+        if (i % 32 == 31 || i == length - 1) { printf("\n"); }
+    }
+}
+
+// REPLAY READER METHODS
+
+ReplayReader::ReplayReader(const uint8_t* data, size_t size) : buffer(data), length(size), pos(REPLAY_HEADER_SIZE), step(0) {
+    flags = 0;
+    physics_hz = 0;
+    seed = 0;
+    if (valid()) {
+        flags = buffer[3];
+        physics_hz = buffer[4] | (buffer[5] << 8);
+        seed = (uint32_t)buffer[6] | ((uint32_t)buffer[7] << 8) | ((uint32_t)buffer[8] << 16) | ((uint32_t)buffer[9] << 24);
+    }
+}
+bool ReplayReader::valid() const {
+    return length >= REPLAY_HEADER_SIZE && buffer[0] == 'P' && buffer[1] == 'R' && buffer[2] == REPLAY_VERSION;
+}
+bool ReplayReader::getVarint(uint32_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < length; shift += 7) {
+        uint8_t byte = buffer[pos++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
+bool ReplayReader::next(uint32_t& record_step, InputType& type, int& arg, int& arg2) {
+    uint32_t delta;
+    if (!valid() || !getVarint(delta) || pos >= length) { return false; }
+    step += delta;
+    record_step = step;
+    type = (InputType)buffer[pos++];
+    arg = 0;
+    arg2 = 0;
+    if (type == INPUT_P2_MOVE_TO) {
+        if (pos >= length) { return false; }
+        arg = buffer[pos++];
+    } else if (type == REPLAY_END) {
+        if (pos + 4 > length) { return false; }
+        arg = buffer[pos] | (buffer[pos + 1] << 8);
+        arg2 = buffer[pos + 2] | (buffer[pos + 3] << 8);
+        pos += 4;
+    }
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary match log: everything needed to re-simulate a match bit for bit.
+//
+//   header : 'P' 'R' version flags hz_lo hz_hi seed(4 bytes, little-endian)
+//   input  : varint(steps since previous record) type [arg]
+//   end    : varint(steps since previous record) REPLAY_END score1(2) score2(2)
+//
+// Only INPUT_P2_MOVE_TO carries an arg byte. Varints are LEB128.
+
+#define REPLAY_VERSION 4 // bump whenever the game RNG or physics change what a seed produces
+#define REPLAY_HEADER_SIZE 10
+#ifndef REPLAY_BUFFER_SIZE
+#define REPLAY_BUFFER_SIZE 4096 // bytes of log kept in RAM while recording
+#endif
+
+#define REPLAY_FLAG_AI1 0x01
+#define REPLAY_FLAG_AI2 0x02
+#define REPLAY_FLAG_WIRELESS 0x04
+#define REPLAY_FLAG_COLLISIONS 0x08
+#define REPLAY_FLAG_FIXED_POINT 0x10
+
+// Inputs that reach the physics thread between steps
+typedef enum {
+    INPUT_P1_LEFT = 0,
+    INPUT_P1_RIGHT = 1,
+    INPUT_P2_LEFT = 2,
+    INPUT_P2_RIGHT = 3,
+    INPUT_SPAWN = 4, // logged only when a ball was actually spawned
+    INPUT_P2_MOVE_TO = 5, // slave paddle byte, arg is the paddle x
+    NUM_INPUTS = 6,
+    REPLAY_END = 0xFF,
+} InputType;
+
+// Replay Recorder Class
+// Appends a match log into a fixed RAM buffer. Recording stops (and the log is
+// marked truncated) once the buffer is full, rather than allocating.
+class ReplayRecorder {
+private:
+    uint8_t buffer[REPLAY_BUFFER_SIZE];
+    size_t length;
+    uint32_t lastStep;
+    bool recording;
+    bool truncated;
+    bool put(uint8_t byte);
+    bool putVarint(uint32_t value);
+public:
+    ReplayRecorder();
+    void begin(uint32_t seed, uint8_t flags, uint16_t physics_hz);
+    void recordInput(uint32_t step, InputType type, uint8_t arg);
+    void end(uint32_t step, int score1, int score2);
+    bool isRecording() const;
+    bool isTruncated() const;
+    const uint8_t* data() const;
+    size_t size() const;
+    void dump() const;
+};
+
+// Replay Reader Class
+// Walks a match log produced by ReplayRecorder.
+class ReplayReader {
+private:
+    const uint8_t* buffer;
+    size_t length;
+    size_t pos;
+    uint32_t step;
+    bool getVarint(uint32_t& value);
+public:
+    uint8_t flags;
+    uint16_t physics_hz;
+    uint32_t seed;
+    ReplayReader(const uint8_t* data, size_t size);
+    bool valid() const;
+    // Reads the next record. For REPLAY_END, arg holds score1 and arg2 score2.
+    bool next(uint32_t& record_step, InputType& type, int& arg, int& arg2);
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,531 @@
+#include "rf_protocol.h"
+#include <string.h>
+#include <math.h>
+
+// HELPER FUNCTIONS ------------------------
+
+// Bounded writer and reader for one frame; overflowing or running off the
+// end clears ok instead of touching memory past the frame
+struct FrameWriter {
+    uint8_t* p;
+    uint8_t* end;
+    bool ok;
+    FrameWriter(uint8_t* data, size_t size) : p(data), end(data + size), ok(true) {}
+    void put(uint8_t byte) {
+        if (p >= end) {
+            ok = false;
+            return;
+        }
+        *p++ = byte;
+    }
+    void putVarint(uint32_t value) {
+        while (value >= 0x80) {
+            put((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        put(value);
+    }
+};
+
+struct FrameReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok;
+    FrameReader(const uint8_t* data, size_t size) : p(data), end(data + size), ok(true) {}
+    uint8_t get() {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+    uint32_t getVarint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 32; shift += 7) {
+            uint8_t byte = get();
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) { return value; }
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+static int varintSize(uint32_t value) {
+    int size = 1;
+    for (; value >= 0x80; value >>= 7) { size++; }
+    return size;
+}
+static uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+static int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+bool operator==(const RfBoardState& a, const RfBoardState& b) {
+    if (a.state != b.state || a.num_balls != b.num_balls) { return false; }
+    for (int i = 0; i < a.num_balls; i++) {
+        if (a.ball_x[i] != b.ball_x[i] || a.ball_y[i] != b.ball_y[i]) { return false; }
+    }
+    return a.paddle_x[0] == b.paddle_x[0] && a.paddle_x[1] == b.paddle_x[1] &&
+           a.score[0] == b.score[0] && a.score[1] == b.score[1];
+}
+
+static uint8_t ballMask(int count) { return (uint8_t)((1u << count) - 1); }
+
+// Ticks from a record to tick, across the 16-bit wrap and within RF_MAX_EXTRAPOLATION
+static float ticksSince(uint16_t record, float tick) {
+    float whole = floorf(tick);
+    float elapsed = (int16_t)((uint16_t)(uint32_t)whole - record) + (tick - whole);
+    return elapsed < 0 ? 0 : elapsed > RF_MAX_EXTRAPOLATION ? RF_MAX_EXTRAPOLATION : elapsed;
+}
+
+float rfPredictX(const RfBoardState& state, int i, float tick) {
+    return state.ball_x[i] + (float)state.ball_vx[i] / RF_VELOCITY_SCALE * ticksSince(state.ball_tick[i], tick);
+}
+float rfPredictY(const RfBoardState& state, int i, float tick) {
+    return state.ball_y[i] + (float)state.ball_vy[i] / RF_VELOCITY_SCALE * ticksSince(state.ball_tick[i], tick);
+}
+
+// Triangle wave: the position of a ball that bounced off lo and hi on the way
+static float foldBetween(float x, float lo, float hi) {
+    float span = hi - lo;
+    if (span <= 0) { return lo; }
+    float p = fmodf(x - lo, 2 * span);
+    if (p < 0) { p += 2 * span; }
+    return lo + (p <= span ? p : 2 * span - p);
+}
+
+static size_t encodeV1(const RfBoardState& s, uint8_t* out) {
+    memset(out, 0, RF_FRAME_SIZE);
+    if (s.state == RF_STATE_GAME) {
+        out[0] = s.num_balls;
+        for (int i = 0; i < s.num_balls; i++) {
+            out[1 + i * 3] = s.ball_x[i];
+            out[2 + i * 3] = s.ball_y[i] & 0xFF;
+            out[3 + i * 3] = (s.ball_y[i] >> 8) & 0xFF;
+        }
+        out[25] = s.paddle_x[0];
+        out[26] = s.paddle_x[1];
+        out[27] = s.score[0] & 0xFF;
+        out[28] = (s.score[0] >> 8) & 0xFF;
+        out[29] = s.score[1] & 0xFF;
+        out[30] = (s.score[1] >> 8) & 0xFF;
+    }
+    out[31] = s.state;
+    return RF_FRAME_SIZE;
+}
+
+static void encodeKeyframe(const RfBoardState& s, FrameWriter& out) {
+    out.put(s.num_balls);
+    for (int i = 0; i < s.num_balls; i++) {
+        out.put(s.ball_x[i]);
+        out.put(s.ball_y[i] & 0xFF);
+        out.put((s.ball_y[i] >> 8) & 0xFF);
+    }
+    out.put(s.paddle_x[0]);
+    out.put(s.paddle_x[1]);
+    out.putVarint(s.score[0]);
+    out.putVarint(s.score[1]);
+}
+
+// Only what changed since base; the ball count is the same in both
+static void encodeDelta(const RfBoardState& base, const RfBoardState& s, FrameWriter& out) {
+    uint8_t ball_mask = 0;
+    for (int i = 0; i < s.num_balls; i++) {
+        if (s.ball_x[i] != base.ball_x[i] || s.ball_y[i] != base.ball_y[i]) { ball_mask |= 1 << i; }
+    }
+    uint8_t mask = (ball_mask ? RF_DELTA_BALLS : 0) |
+                   (s.paddle_x[0] != base.paddle_x[0] ? RF_DELTA_PADDLE1 : 0) |
+                   (s.paddle_x[1] != base.paddle_x[1] ? RF_DELTA_PADDLE2 : 0) |
+                   (s.score[0] != base.score[0] ? RF_DELTA_SCORE1 : 0) |
+                   (s.score[1] != base.score[1] ? RF_DELTA_SCORE2 : 0);
+    out.put(mask);
+    if (ball_mask) {
+        out.put(ball_mask);
+        for (int i = 0; i < s.num_balls; i++) {
+            if (!(ball_mask & (1 << i))) { continue; }
+            out.putVarint(zigzag(s.ball_x[i] - base.ball_x[i]));
+            out.putVarint(zigzag(s.ball_y[i] - base.ball_y[i]));
+        }
+    }
+    if (mask & RF_DELTA_PADDLE1) { out.putVarint(zigzag(s.paddle_x[0] - base.paddle_x[0])); }
+    if (mask & RF_DELTA_PADDLE2) { out.putVarint(zigzag(s.paddle_x[1] - base.paddle_x[1])); }
+    if (mask & RF_DELTA_SCORE1) { out.putVarint(s.score[0]); }
+    if (mask & RF_DELTA_SCORE2) { out.putVarint(s.score[1]); }
+}
+
+// RF FRAME ENCODER METHODS
+
+RfFrameEncoder::RfFrameEncoder(int version) : version(version), sendInterval(RF_SEND_INTERVAL), seq(0), sinceKeyframe(0),
+                                              idle(0), haveLast(false), pendingKeyframe(false) {
+    memset(&last, 0, sizeof(last));
+    memset(&pending, 0, sizeof(pending));
+}
+void RfFrameEncoder::setSendInterval(int frames) { sendInterval = frames < 1 ? 1 : frames; }
+void RfFrameEncoder::reset() { haveLast = false; }
+
+// Fills out (RF_FRAME_SIZE bytes) and returns the frame length
+size_t RfFrameEncoder::encode(const RfBoardState& state, uint8_t* out) {
+    RfBoardState clamped = state;
+    clamped.version = version;
+    if (clamped.num_balls > RF_MAX_BALLS) { clamped.num_balls = RF_MAX_BALLS; }
+    for (int i = 0; i < 2; i++) {
+        if (clamped.score[i] > RF_MAX_SCORE) { clamped.score[i] = RF_MAX_SCORE; }
+    }
+    pendingKeyframe = false;
+    if (version == 1) {
+        pending = clamped;
+        return encodeV1(pending, out);
+    }
+    if (version == 2) {
+        pending = clamped;
+        return encodeV2(out);
+    }
+    return encodeV3(clamped, out);
+}
+
+size_t RfFrameEncoder::encodeV2(uint8_t* out) {
+    uint8_t next = (seq + 1) & RF_V2_SEQ_MASK;
+    out[0] = RF_V2_HEADER | ((pending.state << RF_V2_STATE_SHIFT) & RF_V2_STATE_MASK) | next;
+    if (pending.state != RF_STATE_GAME) { return 1; }
+
+    // a delta needs a base with the same balls, and gives way to a keyframe
+    // every RF_KEYFRAME_INTERVAL frames or whenever it would not be shorter
+    uint8_t delta[RF_FRAME_SIZE];
+    FrameWriter deltaOut(delta, RF_FRAME_SIZE - 1);
+    bool useDelta = haveLast && sinceKeyframe < RF_KEYFRAME_INTERVAL && last.num_balls == pending.num_balls;
+    if (useDelta) {
+        encodeDelta(last, pending, deltaOut);
+        useDelta = deltaOut.ok;
+    }
+    FrameWriter keyOut(out + 1, RF_FRAME_SIZE - 1);
+    encodeKeyframe(pending, keyOut);
+    size_t deltaLength = deltaOut.p - delta;
+    size_t keyLength = keyOut.p - (out + 1);
+    if (useDelta && deltaLength < keyLength) {
+        memcpy(out + 1, delta, deltaLength);
+        memset(out + 1 + deltaLength, 0, keyLength - deltaLength);
+        return 1 + deltaLength;
+    }
+    out[0] |= RF_V2_KEYFRAME;
+    pendingKeyframe = true;
+    return 1 + keyLength;
+}
+
+// pending becomes what the slave will know once this frame arrives
+size_t RfFrameEncoder::encodeV3(const RfBoardState& state, uint8_t* out) {
+    out[0] = RF_V3_HEADER | ((state.state << RF_V2_STATE_SHIFT) & RF_V2_STATE_MASK);
+    bool due = idle + 1 >= sendInterval || !haveLast || last.state != state.state;
+    if (state.state != RF_STATE_GAME) {
+        if (!due) {
+            idle++;
+            return 0;
+        }
+        pending = state;
+        pending.ball_known = 0;
+        return 1;
+    }
+
+    // balls the slave can't predict go out now, unchanged ones now and then
+    bool countChanged = !haveLast || last.num_balls != state.num_balls;
+    uint8_t urgent = 0;
+    uint8_t stale = 0;
+    for (int i = 0; i < state.num_balls; i++) {
+        uint8_t bit = 1 << i;
+        if (countChanged || !(last.ball_known & bit) || last.ball_vx[i] != state.ball_vx[i] || last.ball_vy[i] != state.ball_vy[i] ||
+            fabsf(rfPredictX(last, i, state.tick) - state.ball_x[i]) > RF_PREDICT_TOLERANCE ||
+            fabsf(rfPredictY(last, i, state.tick) - state.ball_y[i]) > RF_PREDICT_TOLERANCE) {
+            urgent |= bit;
+        } else if ((uint16_t)(state.tick - last.ball_tick[i]) >= RF_REFRESH_TICKS) {
+            stale |= bit;
+        }
+    }
+    due = due || urgent || last.score[0] != state.score[0] || last.score[1] != state.score[1];
+    if (!due) {
+        idle++;
+        return 0;
+    }
+
+    RfBoardState view = haveLast ? last : state;
+    if (!haveLast) { view.ball_known = 0; }
+    view.version = 3;
+    view.state = state.state;
+    view.tick = state.tick;
+    view.num_balls = state.num_balls;
+    view.ball_known &= ballMask(state.num_balls);
+    view.paddle_x[0] = state.paddle_x[0];
+    view.paddle_x[1] = state.paddle_x[1];
+    view.score[0] = state.score[0];
+    view.score[1] = state.score[1];
+
+    FrameWriter frame(out + 1, RF_FRAME_SIZE - 1);
+    frame.put(state.tick & 0xFF);
+    frame.put((state.tick >> 8) & 0xFF);
+    frame.put(state.num_balls);
+    frame.put(state.paddle_x[0]);
+    frame.put(state.paddle_x[1]);
+    frame.putVarint(state.score[0]);
+    frame.putVarint(state.score[1]);
+    uint8_t* maskByte = frame.p;
+    frame.put(0);
+
+    // urgent balls in order, then the stalest of the rest, while they fit
+    uint8_t sent = 0;
+    while (urgent | stale) {
+        int pick = -1;
+        for (int i = 0; i < state.num_balls && pick < 0; i++) {
+            if (urgent & (1 << i)) { pick = i; }
+        }
+        for (int i = 0; i < state.num_balls && pick < 0; i++) {
+            if (!(stale & (1 << i))) { continue; }
+            if (pick < 0 || (uint16_t)(state.tick - last.ball_tick[i]) > (uint16_t)(state.tick - last.ball_tick[pick])) { pick = i; }
+        }
+        urgent &= ~(1 << pick);
+        stale &= ~(1 << pick);
+        uint32_t vx = zigzag(state.ball_vx[pick]);
+        uint32_t vy = zigzag(state.ball_vy[pick]);
+        if (frame.end - frame.p < 3 + varintSize(vx) + varintSize(vy)) { break; }
+        frame.put(state.ball_x[pick]);
+        frame.put(state.ball_y[pick] & 0xFF);
+        frame.put((state.ball_y[pick] >> 8) & 0xFF);
+        frame.putVarint(vx);
+        frame.putVarint(vy);
+        view.ball_x[pick] = state.ball_x[pick];
+        view.ball_y[pick] = state.ball_y[pick];
+        view.ball_vx[pick] = state.ball_vx[pick];
+        view.ball_vy[pick] = state.ball_vy[pick];
+        view.ball_tick[pick] = state.tick;
+        view.ball_known |= 1 << pick;
+        sent |= 1 << pick;
+    }
+    *maskByte = sent;
+    pending = view;
+    return 1 + (frame.p - (out + 1));
+}
+
+// The last encoded frame went out, so the next one builds on it
+void RfFrameEncoder::commit() {
+    last = pending;
+    haveLast = pending.state == RF_STATE_GAME;
+    seq = (seq + 1) & RF_V2_SEQ_MASK;
+    sinceKeyframe = pendingKeyframe ? 1 : sinceKeyframe + 1;
+    idle = 0;
+}
+
+// RF FRAME DECODER METHODS
+
+RfFrameDecoder::RfFrameDecoder() : seq(0), synced(false) {
+    memset(&current, 0, sizeof(current));
+}
+
+static bool decodeV1(const uint8_t* data, size_t length, RfBoardState& s) {
+    if (length < RF_FRAME_SIZE || data[0] > RF_MAX_BALLS) { return false; }
+    s.state = data[31];
+    if (s.state != RF_STATE_GAME) { return true; }
+    s.num_balls = data[0];
+    for (int i = 0; i < s.num_balls; i++) {
+        s.ball_x[i] = data[1 + i * 3];
+        s.ball_y[i] = data[2 + i * 3] | (data[3 + i * 3] << 8);
+    }
+    s.paddle_x[0] = data[25];
+    s.paddle_x[1] = data[26];
+    s.score[0] = data[27] | (data[28] << 8);
+    s.score[1] = data[29] | (data[30] << 8);
+    return true;
+}
+
+// Records on top of what the slave already knows; the ball mask only covers
+// the balls that were sent
+static bool decodeV3(const uint8_t* data, size_t length, RfBoardState& s) {
+    bool continues = s.version == 3 && s.state == RF_STATE_GAME;
+    if (!continues) { s.ball_known = 0; }
+    s.version = 3;
+    s.state = (data[0] & RF_V2_STATE_MASK) >> RF_V2_STATE_SHIFT;
+    if (s.state != RF_STATE_GAME) { return true; }
+
+    FrameReader in(data + 1, length - 1);
+    uint16_t tick = in.get();
+    tick |= in.get() << 8;
+    if (continues && (int16_t)(tick - s.tick) < 0) { return false; }
+    uint8_t num_balls = in.get();
+    if (num_balls > RF_MAX_BALLS) { return false; }
+    s.tick = tick;
+    s.num_balls = num_balls;
+    s.ball_known &= ballMask(num_balls);
+    s.paddle_x[0] = in.get();
+    s.paddle_x[1] = in.get();
+    s.score[0] = in.getVarint();
+    s.score[1] = in.getVarint();
+    uint8_t sent = in.get();
+    if (sent & ~ballMask(num_balls)) { return false; }
+    for (int i = 0; i < num_balls; i++) {
+        if (!(sent & (1 << i))) { continue; }
+        s.ball_x[i] = in.get();
+        s.ball_y[i] = in.get();
+        s.ball_y[i] |= in.get() << 8;
+        s.ball_vx[i] = unzigzag(in.getVarint());
+        s.ball_vy[i] = unzigzag(in.getVarint());
+        s.ball_tick[i] = tick;
+    }
+    s.ball_known |= sent;
+    return in.ok;
+}
+
+// v1 and v2 carry no motion, so every ball is a still record
+static void clearMotion(RfBoardState& s, uint8_t version) {
+    s.version = version;
+    s.tick = 0;
+    for (int i = 0; i < RF_MAX_BALLS; i++) {
+        s.ball_vx[i] = 0;
+        s.ball_vy[i] = 0;
+        s.ball_tick[i] = 0;
+    }
+    s.ball_known = ballMask(s.num_balls);
+}
+
+bool RfFrameDecoder::decode(const uint8_t* data, size_t length) {
+    if (length == 0) { return false; }
+    RfBoardState next = current;
+    if (!(data[0] & (RF_V2_HEADER | RF_V3_HEADER))) {
+        // v1 frames stand alone and leave nothing for a delta to build on
+        if (!decodeV1(data, length, next)) { return false; }
+        clearMotion(next, 1);
+        current = next;
+        synced = false;
+        return true;
+    }
+    if (!(data[0] & RF_V2_HEADER)) {
+        synced = false;
+        if (!decodeV3(data, length, next)) { return false; }
+        current = next;
+        return true;
+    }
+
+    uint8_t header = data[0];
+    uint8_t frameSeq = header & RF_V2_SEQ_MASK;
+    next.state = (header & RF_V2_STATE_MASK) >> RF_V2_STATE_SHIFT;
+    FrameReader in(data + 1, length - 1);
+    if (next.state != RF_STATE_GAME) {
+        synced = false;
+    } else if (header & RF_V2_KEYFRAME) {
+        next.num_balls = in.get();
+        if (next.num_balls > RF_MAX_BALLS) { return false; }
+        for (int i = 0; i < next.num_balls; i++) {
+            next.ball_x[i] = in.get();
+            next.ball_y[i] = in.get();
+            next.ball_y[i] |= in.get() << 8;
+        }
+        next.paddle_x[0] = in.get();
+        next.paddle_x[1] = in.get();
+        next.score[0] = in.getVarint();
+        next.score[1] = in.getVarint();
+    } else {
+        // a gap in seq means the base this delta was built on never arrived
+        if (!synced || current.state != RF_STATE_GAME || frameSeq != ((seq + 1) & RF_V2_SEQ_MASK)) {
+            synced = false;
+            return false;
+        }
+        uint8_t mask = in.get();
+        if (mask & RF_DELTA_BALLS) {
+            uint8_t ball_mask = in.get();
+            for (int i = 0; i < next.num_balls; i++) {
+                if (!(ball_mask & (1 << i))) { continue; }
+                next.ball_x[i] += unzigzag(in.getVarint());
+                next.ball_y[i] += unzigzag(in.getVarint());
+            }
+        }
+        if (mask & RF_DELTA_PADDLE1) { next.paddle_x[0] += unzigzag(in.getVarint()); }
+        if (mask & RF_DELTA_PADDLE2) { next.paddle_x[1] += unzigzag(in.getVarint()); }
+        if (mask & RF_DELTA_SCORE1) { next.score[0] = in.getVarint(); }
+        if (mask & RF_DELTA_SCORE2) { next.score[1] = in.getVarint(); }
+    }
+    if (!in.ok) {
+        synced = false;
+        return false;
+    }
+    clearMotion(next, 2);
+    current = next;
+    seq = frameSeq;
+    synced = next.state == RF_STATE_GAME;
+    return true;
+}
+const RfBoardState& RfFrameDecoder::getState() const { return current; }
+
+// RF BALL TRACKER METHODS
+
+RfBallTracker::RfBallTracker() : minX(0), maxX(255), minY(0), maxY(65535) { reset(); }
+void RfBallTracker::setBounds(float min_x, float max_x, float min_y, float max_y) {
+    minX = min_x;
+    maxX = max_x;
+    minY = min_y;
+    maxY = max_y;
+}
+void RfBallTracker::reset() {
+    lastTick = 0;
+    started = false;
+    shownMask = 0;
+    memset(&previous, 0, sizeof(previous));
+    for (int p = 0; p < 2; p++) {
+        shownPaddle[p] = 0;
+        paddleOffset[p] = 0;
+        paddleTarget[p] = -1;
+    }
+}
+
+// tick is the master tick the slave reckons it is now, wrapping at 65536
+void RfBallTracker::update(const RfBoardState& state, float tick) {
+    float elapsed = started ? tick - lastTick : 0;
+    if (elapsed < -32768) { elapsed += 65536; }
+    float decay = elapsed > 0 ? exp2f(-elapsed / RF_SMOOTH_HALF_LIFE) : 1;
+    lastTick = tick;
+    started = true;
+
+    uint8_t shown = 0;
+    for (int i = 0; i < state.num_balls; i++) {
+        uint8_t bit = 1 << i;
+        if (!(state.ball_known & bit)) { continue; }
+        float x = foldBetween(rfPredictX(state, i, tick), minX, maxX);
+        float y = fminf(fmaxf(rfPredictY(state, i, tick), minY), maxY);
+        if (!(shownMask & bit)) {
+            offsetX[i] = 0;
+            offsetY[i] = 0;
+        } else if (state.ball_tick[i] != previous.ball_tick[i] || state.ball_x[i] != previous.ball_x[i] ||
+                   state.ball_y[i] != previous.ball_y[i]) {
+            // a new record: start from where the old one would have put the
+            // ball now, and ease over to the new prediction
+            float oldX = foldBetween(rfPredictX(previous, i, tick), minX, maxX) + offsetX[i] * decay;
+            float oldY = fminf(fmaxf(rfPredictY(previous, i, tick), minY), maxY) + offsetY[i] * decay;
+            offsetX[i] = state.version >= 3 ? oldX - x : 0;
+            offsetY[i] = state.version >= 3 ? oldY - y : 0;
+            if (hypotf(offsetX[i], offsetY[i]) > RF_SNAP_DISTANCE) {
+                offsetX[i] = 0;
+                offsetY[i] = 0;
+            }
+        } else {
+            offsetX[i] *= decay;
+            offsetY[i] *= decay;
+        }
+        shownX[i] = x + offsetX[i];
+        shownY[i] = y + offsetY[i];
+        shown |= bit;
+    }
+    shownMask = shown;
+
+    // v3 paddles only move when a frame arrives, so they get eased the same way
+    for (int p = 0; p < 2; p++) {
+        int target = state.paddle_x[p];
+        if (paddleTarget[p] < 0 || state.version < 3) {
+            paddleOffset[p] = 0;
+        } else if (target != paddleTarget[p]) {
+            paddleOffset[p] = paddleOffset[p] * decay + paddleTarget[p] - target;
+            if (fabsf(paddleOffset[p]) > RF_SNAP_DISTANCE) { paddleOffset[p] = 0; }
+        } else {
+            paddleOffset[p] *= decay;
+        }
+        paddleTarget[p] = target;
+        shownPaddle[p] = target + paddleOffset[p];
+    }
+    previous = state;
+}
+bool RfBallTracker::isShown(int i) const { return i >= 0 && i < RF_MAX_BALLS && (shownMask & (1 << i)); }
+float RfBallTracker::getX(int i) const { return shownX[i]; }
+float RfBallTracker::getY(int i) const { return shownY[i]; }
+float RfBallTracker::getPaddleX(int paddle) const { return shownPaddle[paddle]; }
@@ -0,0 +1,161 @@
+#ifndef RF_PROTOCOL_H
+#define RF_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Board-state frames from master to slave (docs/rf_protocol.md).
+//
+//   v1       : 32 bytes, every field every frame, state in byte 31
+//   v2       : header [keyframe body | delta body]
+//   header   : 0x80 | keyframe << 6 | state << 4 | seq (v1 starts with a ball
+//              count of at most 8, so the two can't be confused)
+//   keyframe : count {x y_lo y_hi}*count paddle1 paddle2 varint(score1) varint(score2)
+//   delta    : mask [ball_mask {zz(dx) zz(dy)}*balls set] [zz(dpaddle1)] [zz(dpaddle2)]
+//              [varint(score1)] [varint(score2)]
+//   v3       : 0x40 | state << 4, then tick_lo tick_hi count paddle1 paddle2
+//              varint(score1) varint(score2) ball_mask {x y_lo y_hi zz(vx) zz(vy)}*balls set
+//
+// Outside STATE_GAME a v2 or v3 frame is the header alone. seq counts frames
+// mod 16, and a v2 delta only applies on top of the frame just before it, so
+// after a lost frame the slave waits for the next keyframe. Varints are LEB128
+// as in replay.h. zz() is zigzag coding, which keeps small negative deltas in
+// one byte. Scores saturate at RF_MAX_SCORE so a full keyframe fits in 32 bytes.
+//
+// v3 records stand alone: each ball carries its velocity and the master tick
+// (physics step) it was taken at, and the slave dead-reckons it from there.
+// The master sends every RF_SEND_INTERVAL frames and straight away when a ball
+// turns, appears or drifts off the slave's prediction, and only those balls.
+
+#define RF_MAX_BALLS 8 // ball slots in a frame
+#ifndef RF_PROTOCOL_VERSION
+#define RF_PROTOCOL_VERSION 3 // 1 fixed 32-byte frames, 2 keyframes and deltas, 3 velocities and dead reckoning
+#endif
+#define RF_KEYFRAME_INTERVAL 25 // frames between v2 keyframes, half a second at 50 fps
+#define RF_FRAME_SIZE 32 // largest frame, and the v1 size
+
+#define RF_MAX_SCORE 16383 // largest score with a two-byte varint
+#define RF_STATE_GAME 2 // STATE_GAME, the only state with a body
+
+#define RF_V2_HEADER 0x80
+#define RF_V2_KEYFRAME 0x40
+#define RF_V2_STATE_SHIFT 4
+#define RF_V2_STATE_MASK 0x30
+#define RF_V2_SEQ_MASK 0x0F
+#define RF_V3_HEADER 0x40 // with bit 7 clear; state as in v2, low nibble reserved
+
+#ifndef RF_SEND_INTERVAL
+#define RF_SEND_INTERVAL 4 // v3 frames between sends when every ball is on course
+#endif
+#define RF_VELOCITY_SCALE 64 // v3 velocities are in 1/64 px per tick
+#define RF_PREDICT_TOLERANCE 1.5f // px a ball may drift from the slave's prediction
+#define RF_REFRESH_TICKS 100 // ticks before an unchanged ball is sent again anyway
+#define RF_MAX_EXTRAPOLATION 60 // ticks the slave carries a ball past its last record
+#define RF_SMOOTH_HALF_LIFE 6.0f // ticks for half of a correction to be eased out
+#define RF_SNAP_DISTANCE 24.0f // px beyond which a correction is shown at once
+
+// Delta mask bits
+#define RF_DELTA_BALLS 0x01
+#define RF_DELTA_PADDLE1 0x02
+#define RF_DELTA_PADDLE2 0x04
+#define RF_DELTA_SCORE1 0x08
+#define RF_DELTA_SCORE2 0x10
+
+// What one frame tells the slave. tick, the velocities and the per-ball ticks
+// only travel in v3; a v1 or v2 frame leaves them at zero.
+struct RfBoardState {
+    uint8_t version;
+    uint8_t state;
+    uint8_t num_balls;
+    uint16_t tick;
+    uint8_t ball_x[RF_MAX_BALLS];
+    uint16_t ball_y[RF_MAX_BALLS];
+    int16_t ball_vx[RF_MAX_BALLS];
+    int16_t ball_vy[RF_MAX_BALLS];
+    uint16_t ball_tick[RF_MAX_BALLS];
+    uint8_t ball_known; // balls the slave has a record for
+    uint8_t paddle_x[2];
+    uint16_t score[2];
+};
+
+// Compares what every version carries: state, balls, paddles and scores
+bool operator==(const RfBoardState& a, const RfBoardState& b);
+
+// Where ball i's last record puts it at tick, before the side walls fold it
+float rfPredictX(const RfBoardState& state, int i, float tick);
+float rfPredictY(const RfBoardState& state, int i, float tick);
+
+// RF Frame Encoder Class
+// Builds frames on the master. encode only prepares one; commit makes it the
+// base for the next delta (v2) or the slave's view (v3) once it has actually
+// been handed to the radio.
+class RfFrameEncoder {
+private:
+    int version;
+    int sendInterval;
+    RfBoardState last;
+    RfBoardState pending;
+    uint8_t seq;
+    int sinceKeyframe;
+    int idle;
+    bool haveLast;
+    bool pendingKeyframe;
+    size_t encodeV2(uint8_t* out);
+    size_t encodeV3(const RfBoardState& state, uint8_t* out);
+public:
+    RfFrameEncoder(int version = RF_PROTOCOL_VERSION);
+    void setSendInterval(int frames);
+    void reset(); // the next game frame is a keyframe, or resends every ball
+    // 0 when v3 has nothing the slave can't predict this frame
+    size_t encode(const RfBoardState& state, uint8_t* out);
+    void commit();
+};
+
+// RF Frame Decoder Class
+// Rebuilds the board state on the slave from v1, v2 or v3 frames.
+class RfFrameDecoder {
+private:
+    RfBoardState current;
+    uint8_t seq;
+    bool synced;
+public:
+    RfFrameDecoder();
+    // False for a malformed frame, a delta whose base was lost or a v3 frame
+    // older than the last; the state is left as it was
+    bool decode(const uint8_t* data, size_t length);
+    const RfBoardState& getState() const;
+};
+
+// RF Ball Tracker Class
+// Shows the slave's board between frames: balls are dead-reckoned from their
+// last record, bouncing off the side walls, and the jump when a new record
+// corrects them (or a paddle moves) is eased out over RF_SMOOTH_HALF_LIFE.
+class RfBallTracker {
+private:
+    float minX;
+    float maxX;
+    float minY;
+    float maxY;
+    float lastTick;
+    bool started;
+    uint8_t shownMask;
+    float shownX[RF_MAX_BALLS];
+    float shownY[RF_MAX_BALLS];
+    float offsetX[RF_MAX_BALLS];
+    float offsetY[RF_MAX_BALLS];
+    RfBoardState previous;
+    float shownPaddle[2];
+    float paddleOffset[2];
+    int paddleTarget[2];
+public:
+    RfBallTracker();
+    void setBounds(float min_x, float max_x, float min_y, float max_y); // ball centres
+    void reset();
+    void update(const RfBoardState& state, float tick);
+    bool isShown(int i) const;
+    float getX(int i) const;
+    float getY(int i) const;
+    float getPaddleX(int paddle) const;
+};
+
+#endif // RF_PROTOCOL_H
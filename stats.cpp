@@ -0,0 +1,121 @@
+#include "stats.h"
+#include "gfx.h"
+#include <stdio.h>
+#include <algorithm>
+
+Stats stats;
+
+// STATS METHODS
+
+Stats::Stats() : current(), window(), frames(0), frameStart(0), lastEnd(0), physicsCycles(0), physicsSteps(0), overlay(false) {}
+
+// Called by each gfx primitive
+void Stats::countDraw(uint32_t pixels, uint32_t transfers) {
+    if (!STATS_ENABLED) { return; }
+    current.drawCalls++;
+    current.pixels += pixels;
+    current.transfers += transfers;
+}
+
+// Called from the physics thread after each batch of steps
+void Stats::countPhysics(uint32_t cycles, uint32_t steps) {
+    if (!STATS_ENABLED) { return; }
+    physicsCycles += cycles;
+    physicsSteps += steps;
+}
+
+void Stats::beginFrame() {
+    if (!STATS_ENABLED) { return; }
+    frameStart = statsCycles();
+}
+
+// Closes the frame: its time, the gap since the last one and the physics
+// time that built up meanwhile go into the window
+void Stats::endFrame() {
+    if (!STATS_ENABLED) { return; }
+    uint32_t now = statsCycles();
+    current.frameCycles = now - frameStart;
+    current.intervalCycles = frames ? now - lastEnd : 0;
+    current.physicsCycles = physicsCycles.exchange(0);
+    current.physicsSteps = physicsSteps.exchange(0);
+    window[frames & (STATS_WINDOW - 1)] = current;
+    current = FrameCounters();
+    lastEnd = now;
+    frames++;
+#if STATS_DUMP_FRAMES
+    if (frames % STATS_DUMP_FRAMES == 0) { print(); }
+#endif
+}
+
+uint32_t Stats::getFrames() const { return frames; }
+
+float Stats::percentileUs(int percent) const {
+    int n = std::min(frames, (uint32_t)STATS_WINDOW);
+    if (n == 0) { return 0; }
+    uint32_t cycles[STATS_WINDOW];
+    for (int i = 0; i < n; i++) { cycles[i] = window[i].frameCycles; }
+    int k = std::min(n * percent / 100, n - 1);
+    std::nth_element(cycles, cycles + k, cycles + n);
+    return (float)cycles[k] / statsCyclesPerUs();
+}
+
+float Stats::getFrameUsP50() const { return percentileUs(50); }
+float Stats::getFrameUsP99() const { return percentileUs(99); }
+
+float Stats::getFps() const {
+    int n = std::min(frames, (uint32_t)STATS_WINDOW);
+    uint64_t total = 0;
+    int intervals = 0;
+    for (int i = 0; i < n; i++) {
+        if (window[i].intervalCycles) {
+            total += window[i].intervalCycles;
+            intervals++;
+        }
+    }
+    return total ? intervals * 1e6f * statsCyclesPerUs() / total : 0;
+}
+
+// Per-frame means over the window, rounded
+FrameCounters Stats::getAverage() const {
+    int n = std::min(frames, (uint32_t)STATS_WINDOW);
+    uint64_t sum[7] = {0};
+    for (int i = 0; i < n; i++) {
+        const FrameCounters& f = window[i];
+        uint32_t values[7] = {f.drawCalls, f.pixels, f.transfers, f.frameCycles, f.intervalCycles, f.physicsCycles, f.physicsSteps};
+        for (int v = 0; v < 7; v++) { sum[v] += values[v]; }
+    }
+    FrameCounters average = FrameCounters();
+    if (n == 0) { return average; }
+    average.drawCalls = (sum[0] + n / 2) / n;
+    average.pixels = (sum[1] + n / 2) / n;
+    average.transfers = (sum[2] + n / 2) / n;
+    average.frameCycles = (sum[3] + n / 2) / n;
+    average.intervalCycles = (sum[4] + n / 2) / n;
+    average.physicsCycles = (sum[5] + n / 2) / n;
+    average.physicsSteps = (sum[6] + n / 2) / n;
+    return average;
+}
+
+bool Stats::getOverlay() const { return overlay; }
+void Stats::toggleOverlay() { overlay = !overlay; }
+
+// One line for the serial console
+void Stats::print() const {
+    FrameCounters a = getAverage();
+    printf("[Stats] frames %lu  fps %.1f  frame us p50 %.1f p99 %.1f  per frame: draws %lu px %lu dma2d %lu physics us %.1f (%lu steps)\n",
+           (unsigned long)frames, getFps(), getFrameUsP50(), getFrameUsP99(),
+           (unsigned long)a.drawCalls, (unsigned long)a.pixels, (unsigned long)a.transfers,
+           (float)a.physicsCycles / statsCyclesPerUs(), (unsigned long)a.physicsSteps);
+}
+
+// FPS and frame time percentiles in the HUD page, just below the scoreboard.
+// The line's black background is transparent there, so the game shows
+// through around the text.
+void Stats::drawOverlay(int y, int width) const {
+    char line[48];
+    snprintf(line, sizeof(line), "%3.0f fps  p50 %4.1f ms  p99 %4.1f ms", getFps(), getFrameUsP50() / 1000.0f, getFrameUsP99() / 1000.0f);
+    gfxBeginOverlay(GFX_OVERLAY_HUD);
+    gfxFillRect(0, y, width, STATS_OVERLAY_HEIGHT, LCD_COLOR_BLACK);
+    gfxDrawString(2, y, line, &Font8, LCD_COLOR_WHITE, LCD_COLOR_BLACK, LEFT_MODE);
+    gfxEndOverlay();
+}
@@ -0,0 +1,68 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+#include <atomic>
+
+#ifndef STATS_ENABLED
+#define STATS_ENABLED 1 // 1 to count draws and time frames; the overlay itself is toggled at run time
+#endif
+#ifndef STATS_DUMP_FRAMES
+#define STATS_DUMP_FRAMES 0 // print a stats line over serial every this many frames, 0 for never
+#endif
+#define STATS_WINDOW 128 // frames the averages and percentiles cover, must be a power of two
+#define STATS_OVERLAY_HEIGHT 8 // rows of HUD the overlay line takes, below the scoreboard (Font8)
+#define STATS_OVERLAY_PERIOD 25 // frames between overlay redraws, so it barely shows in what it measures
+
+// Cycle clock behind the timings: the DWT cycle counter on the board
+// (main.cpp), steady_clock in nanoseconds on the host (host_hal.cpp)
+void statsInitClock();
+uint32_t statsCycles();
+uint32_t statsCyclesPerUs();
+
+// What one game frame cost
+struct FrameCounters {
+    uint32_t drawCalls;   // gfx primitives issued
+    uint32_t pixels;      // pixels those primitives touched
+    uint32_t transfers;   // DMA2D transfers they queued
+    uint32_t frameCycles;    // stateGame, from the snapshot to the frame being ready to present
+    uint32_t intervalCycles; // since the previous frame finished
+    uint32_t physicsCycles;  // physics thread time since the previous frame
+    uint32_t physicsSteps;
+};
+
+// Stats Class
+// Collects FrameCounters for the last STATS_WINDOW frames. The gfx primitives
+// report into the frame being built, the physics thread adds its time from
+// its own thread, and the render loop brackets each frame.
+class Stats {
+private:
+    FrameCounters current;
+    FrameCounters window[STATS_WINDOW];
+    uint32_t frames;
+    uint32_t frameStart;
+    uint32_t lastEnd;
+    std::atomic<uint32_t> physicsCycles;
+    std::atomic<uint32_t> physicsSteps;
+    bool overlay;
+    float percentileUs(int percent) const;
+public:
+    Stats();
+    void countDraw(uint32_t pixels, uint32_t transfers);
+    void countPhysics(uint32_t cycles, uint32_t steps);
+    void beginFrame();
+    void endFrame();
+    uint32_t getFrames() const;
+    float getFps() const;
+    float getFrameUsP50() const;
+    float getFrameUsP99() const;
+    FrameCounters getAverage() const;
+    bool getOverlay() const;
+    void toggleOverlay();
+    void print() const;
+    void drawOverlay(int y, int width) const;
+};
+
+extern Stats stats;
+
+#endif // STATS_H